@@ -0,0 +1,171 @@
+#include "DemandGenerator.hpp"
+
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+uint64_t DemandGenerator::Stream::next() {
+	state += 0x9e3779b97f4a7c15ULL;
+	uint64_t z = state;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+double DemandGenerator::Stream::uniform() {
+	return double(next() >> 11) * (1.0 / 9007199254740992.0); //53 bits
+}
+
+void DemandGenerator::AliasTable::build(std::vector< Location > const &locations_, std::vector< float > const &weights) {
+	locations = locations_;
+	uint32_t n = uint32_t(locations.size());
+	if (n == 0) throw std::runtime_error("DemandGenerator needs at least one store and one client.");
+	if (!weights.empty() && weights.size() != n) {
+		throw std::runtime_error("DemandModel has " + std::to_string(weights.size()) + " weights for " + std::to_string(n) + " locations.");
+	}
+
+	double total = 0.0;
+	for (float w : weights) {
+		if (!(w >= 0.0f)) throw std::runtime_error("DemandModel weights must be non-negative.");
+		total += w;
+	}
+	if (!weights.empty() && !(total > 0.0)) throw std::runtime_error("DemandModel weights must not all be zero.");
+
+	//Vose's method: split scaled weights into 'small' (< 1) and 'large' (>= 1), then pair them up:
+	std::vector< double > scaled(n);
+	for (uint32_t i = 0; i < n; ++i) {
+		scaled[i] = (weights.empty() ? 1.0 : weights[i] * n / total);
+	}
+	probability.assign(n, 1.0f);
+	alias.resize(n);
+	for (uint32_t i = 0; i < n; ++i) alias[i] = i;
+
+	std::vector< uint32_t > small, large;
+	for (uint32_t i = 0; i < n; ++i) {
+		(scaled[i] < 1.0 ? small : large).emplace_back(i);
+	}
+	while (!small.empty() && !large.empty()) {
+		uint32_t s = small.back(); small.pop_back();
+		uint32_t l = large.back();
+		probability[s] = float(scaled[s]);
+		alias[s] = l;
+		scaled[l] -= 1.0 - scaled[s];
+		if (scaled[l] < 1.0) {
+			large.pop_back();
+			small.emplace_back(l);
+		}
+	}
+	//(whatever is left is 1.0 up to rounding, so keeps probability 1)
+}
+
+Location DemandGenerator::AliasTable::sample(Stream &stream) const {
+	uint64_t bits = stream.next();
+	//high 32 bits pick the column, low 32 bits pick between it and its alias:
+	uint32_t column = uint32_t(((bits >> 32) * uint64_t(locations.size())) >> 32);
+	float coin = float(uint32_t(bits)) * (1.0f / 4294967296.0f);
+	return locations[coin < probability[column] ? column : alias[column]];
+}
+
+DemandGenerator::DemandGenerator(uint32_t seed_, DemandModel const &model_) {
+	seed(seed_);
+	set_model(model_);
+}
+
+void DemandGenerator::seed(uint32_t value) {
+	//distinct, well-separated starting points for each stream:
+	Stream mix;
+	mix.state = value;
+	arrival_stream.state = mix.next();
+	location_stream.state = mix.next();
+	terms_stream.state = mix.next();
+	last_time = 0.0;
+	schedule_next();
+}
+
+void DemandGenerator::set_model(DemandModel const &model_) {
+	if (!(model_.orders_per_hour >= 0.0f)) throw std::runtime_error("DemandModel orders_per_hour must be non-negative.");
+	if (!model_.rate_curve.empty() && !(model_.period > 0.0f)) throw std::runtime_error("DemandModel period must be positive.");
+	if (model_.min_income > model_.max_income || !(model_.min_time <= model_.max_time)) {
+		throw std::runtime_error("DemandModel ranges must have min <= max.");
+	}
+
+	LocationCatalog const &catalog = get_location_catalog();
+	stores.build(catalog.stores, model_.store_weights);
+	clients.build(catalog.clients, model_.client_weights);
+
+	max_multiplier = 1.0f;
+	if (!model_.rate_curve.empty()) {
+		max_multiplier = 0.0f;
+		for (float m : model_.rate_curve) {
+			if (!(m >= 0.0f)) throw std::runtime_error("DemandModel rate_curve must be non-negative.");
+			max_multiplier = std::max(max_multiplier, m);
+		}
+	}
+
+	model = model_;
+	max_rate = double(model.orders_per_hour) / 3600.0 * max_multiplier;
+	schedule_next();
+}
+
+float DemandGenerator::rate_at(double t) const {
+	if (model.rate_curve.empty()) return 1.0f;
+	double phase = std::fmod(t, double(model.period)) / model.period;
+	if (phase < 0.0) phase += 1.0;
+	size_t i = std::min(size_t(phase * model.rate_curve.size()), model.rate_curve.size() - 1);
+	return model.rate_curve[i];
+}
+
+void DemandGenerator::schedule_next() {
+	if (!(max_rate > 0.0)) {
+		next_time = std::numeric_limits< double >::infinity();
+		return;
+	}
+	//thinning: candidates arrive at the peak rate; each is kept with probability rate(t) / peak:
+	double t = last_time;
+	while (true) {
+		t += -std::log1p(-arrival_stream.uniform()) / max_rate;
+		if (arrival_stream.uniform() * max_multiplier < rate_at(t)) break;
+	}
+	next_time = t;
+}
+
+uint32_t DemandGenerator::generate(double until, std::vector< Arrival > *arrivals) {
+	uint32_t count = 0;
+	while (next_time < until) {
+		Order order{
+			stores.sample(location_stream),
+			clients.sample(location_stream),
+			false, false,
+			model.min_income + int((terms_stream.next() >> 32) * uint64_t(model.max_income - model.min_income + 1) >> 32),
+			model.min_time + float(terms_stream.uniform()) * (model.max_time - model.min_time)
+		};
+		if (arrivals) arrivals->emplace_back(Arrival{next_time, order});
+		count += 1;
+
+		last_time = next_time;
+		schedule_next();
+	}
+	return count;
+}
+
+struct DemandState {
+	uint64_t arrival_state, location_state, terms_state;
+	double last_time, next_time;
+};
+
+void DemandGenerator::save(std::ostream *to) const {
+	write_chunk_value("dmd0", DemandState{arrival_stream.state, location_stream.state, terms_stream.state, last_time, next_time}, to);
+}
+
+void DemandGenerator::load(std::istream &from) {
+	DemandState state = read_chunk_value< DemandState >(from, "dmd0");
+	arrival_stream.state = state.arrival_state;
+	location_stream.state = state.location_state;
+	terms_stream.state = state.terms_state;
+	last_time = state.last_time;
+	next_time = state.next_time;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+/*
+ * DemandGenerator produces the stream of customer orders.
+ *
+ * Arrivals are a Poisson process whose rate follows an (optional) time-of-day
+ *  curve, sampled by thinning; stores and clients are picked with per-location
+ *  weights from alias tables (O(1) per pick).
+ *
+ * Each kind of draw (arrival times, locations, order terms) has its own seeded
+ *  stream, so e.g. changing location weights does not move arrival times, and
+ *  the same seed + model always gives the same orders.
+ */
+
+#include "OrderModels.hpp"
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+struct DemandModel {
+	//mean arrival rate where the curve is 1.0:
+	float orders_per_hour = 360.0f;
+	//rate multipliers evenly spaced over 'period' seconds (each held until the next); empty for a constant rate:
+	std::vector< float > rate_curve;
+	float period = 24.0f * 60.0f * 60.0f;
+	//relative demand per store / client (indexed like LocationCatalog::stores / clients); empty for uniform:
+	std::vector< float > store_weights;
+	std::vector< float > client_weights;
+	//order terms (uniform in [min, max]):
+	int min_income = 10;
+	int max_income = 50;
+	float min_time = 30.0f;
+	float max_time = 90.0f;
+	//seconds a pending order waits to be accepted before the customer cancels it (0 waits forever):
+	float patience = 120.0f;
+	//most orders pending at once -- arrivals beyond this are turned away (0 for no limit):
+	// (applied by OrderController; the generator's streams don't depend on it)
+	uint32_t max_pending = 0;
+};
+
+struct DemandGenerator {
+	//locations come from the current location catalog; throws if the model doesn't match it:
+	explicit DemandGenerator(uint32_t seed = 0, DemandModel const &model = DemandModel());
+
+	//restart every stream (arrivals start over from time 0):
+	void seed(uint32_t value);
+	//change the model (rebuilds the alias tables; call again after changing the location catalog):
+	// keeps the streams, and reschedules the next arrival from the time of the last one.
+	void set_model(DemandModel const &model);
+	DemandModel const &get_model() const { return model; }
+
+	struct Arrival {
+		double time; //seconds since the generator was seeded
+		Order order;
+	};
+	//append every order arriving before 'until', oldest first; returns the number appended:
+	uint32_t generate(double until, std::vector< Arrival > *arrivals);
+
+	//time of the next arrival (infinity if the rate is zero):
+	double next_arrival() const { return next_time; }
+
+	//rate multiplier at time 't':
+	float rate_at(double t) const;
+
+	//write / restore the streams and arrival clock (not the model -- load into a generator with the same model):
+	void save(std::ostream *to) const;
+	void load(std::istream &from);
+
+private:
+	//splitmix64: tiny state, fast, and good enough for simulation:
+	struct Stream {
+		uint64_t state = 0;
+		uint64_t next();
+		double uniform(); //[0,1)
+	};
+	Stream arrival_stream, location_stream, terms_stream;
+
+	//Vose alias table over a list of locations:
+	struct AliasTable {
+		void build(std::vector< Location > const &locations, std::vector< float > const &weights);
+		Location sample(Stream &stream) const;
+		std::vector< Location > locations;
+		std::vector< float > probability;
+		std::vector< uint32_t > alias;
+	};
+	AliasTable stores, clients;
+
+	void schedule_next();
+	DemandModel model;
+	double last_time = 0.0;
+	double next_time = 0.0;
+	double max_rate = 0.0; //arrivals per second at the curve's peak
+	float max_multiplier = 0.0f;
+};
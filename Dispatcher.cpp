@@ -0,0 +1,299 @@
+#include "Dispatcher.hpp"
+
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+std::unique_ptr< Dispatcher > Dispatcher::make(std::string const &name) {
+	if (name == "greedy") return std::make_unique< GreedyDispatcher >();
+	if (name == "hungarian") return std::make_unique< HungarianDispatcher >();
+	if (name == "insertion") return std::make_unique< InsertionDispatcher >();
+	throw std::runtime_error("Unknown dispatcher '" + name + "' (expected greedy, hungarian, or insertion).");
+}
+
+void Dispatcher::save(std::ostream *to) const {
+	std::string name = state_name();
+	std::vector< double > state;
+	get_state(&state);
+	write_chunk("dsn0", std::vector< char >(name.begin(), name.end()), to);
+	write_chunk("dsp0", state, to);
+}
+
+void Dispatcher::load(std::istream &from) {
+	std::vector< char > name;
+	std::vector< double > state;
+	read_chunk(from, "dsn0", &name);
+	read_chunk(from, "dsp0", &state);
+	if (std::string(name.begin(), name.end()) == state_name()) {
+		set_state(state);
+	}
+}
+
+//time for an idle courier to carry 'order' (drive to store, then to client):
+static float trip_time(DispatchContext const &context, uint32_t courier, Order const &order) {
+	TravelTimes const &times = context.travel_times;
+	return times.time(context.fleet.position[courier], order.store) + times.time(order.store, order.client);
+}
+
+//----------------------------------------------------------------
+
+void GreedyDispatcher::dispatch(DispatchContext const &context, std::vector< Assignment > *assignments) {
+	assert(assignments);
+	context.orders.pending_orders_.ids_by_age(&pending);
+	Fleet const &fleet = context.fleet;
+
+	std::vector< bool > taken(fleet.size(), false);
+	for (OrderId id : pending) {
+		Location store = context.orders.pending_orders_.get(id)->store;
+		uint32_t best = -1U;
+		float best_time = std::numeric_limits< float >::infinity();
+		bool any_idle = false;
+		for (uint32_t c = 0; c < fleet.size(); ++c) {
+			if (!fleet.idle(c) || taken[c]) continue;
+			any_idle = true;
+			float time = context.travel_times.time(fleet.position[c], store);
+			if (!std::isfinite(time)) continue; //(can't reach the store)
+			if (best == -1U || time < best_time) {
+				best = c;
+				best_time = time;
+			}
+		}
+		if (!any_idle) break; //no idle couriers left
+		if (best == -1U) continue; //no idle courier can reach this store
+		taken[best] = true;
+		assignments->emplace_back(Assignment{id, best, 0, 1});
+	}
+}
+
+//----------------------------------------------------------------
+
+//minimum-cost assignment of each row to a distinct column (rows <= cols), by the
+// O(rows^2 * cols) shortest-augmenting-path method with potentials;
+// 'cost' is row-major, rows x cols, and must be finite. Returns the column chosen for each row.
+static std::vector< uint32_t > hungarian(std::vector< float > const &cost, uint32_t rows, uint32_t cols) {
+	assert(rows <= cols);
+	assert(cost.size() == size_t(rows) * cols);
+	assert(std::all_of(cost.begin(), cost.end(), [](float c){ return std::isfinite(c); }));
+	float const inf = std::numeric_limits< float >::infinity();
+
+	//1-based arrays, column 0 is a virtual start column:
+	std::vector< float > u(rows + 1, 0.0f), v(cols + 1, 0.0f);
+	std::vector< uint32_t > match(cols + 1, 0); //row matched to each column (0 = none)
+	std::vector< uint32_t > way(cols + 1, 0);
+	std::vector< float > min_slack(cols + 1);
+	std::vector< bool > used(cols + 1);
+
+	for (uint32_t row = 1; row <= rows; ++row) {
+		match[0] = row;
+		uint32_t col0 = 0;
+		std::fill(min_slack.begin(), min_slack.end(), inf);
+		std::fill(used.begin(), used.end(), false);
+		do {
+			used[col0] = true;
+			uint32_t row0 = match[col0];
+			float delta = inf;
+			uint32_t col1 = 0;
+			for (uint32_t col = 1; col <= cols; ++col) {
+				if (used[col]) continue;
+				float slack = cost[(row0 - 1) * cols + (col - 1)] - u[row0] - v[col];
+				if (slack < min_slack[col]) {
+					min_slack[col] = slack;
+					way[col] = col0;
+				}
+				if (min_slack[col] < delta) {
+					delta = min_slack[col];
+					col1 = col;
+				}
+			}
+			for (uint32_t col = 0; col <= cols; ++col) {
+				if (used[col]) {
+					u[match[col]] += delta;
+					v[col] -= delta;
+				} else {
+					min_slack[col] -= delta;
+				}
+			}
+			col0 = col1;
+		} while (match[col0] != 0);
+		//flip the augmenting path:
+		do {
+			uint32_t col1 = way[col0];
+			match[col0] = match[col1];
+			col0 = col1;
+		} while (col0 != 0);
+	}
+
+	std::vector< uint32_t > assignment(rows, -1U);
+	for (uint32_t col = 1; col <= cols; ++col) {
+		if (match[col] != 0) assignment[match[col] - 1] = col - 1;
+	}
+	return assignment;
+}
+
+void HungarianDispatcher::dispatch(DispatchContext const &context, std::vector< Assignment > *assignments) {
+	assert(assignments);
+	if (context.time < next_batch) return;
+	next_batch = context.time + batch_interval;
+
+	context.orders.pending_orders_.ids_by_age(&pending);
+	Fleet const &fleet = context.fleet;
+	if (pending.empty()) return;
+
+	std::vector< uint32_t > idle;
+	for (uint32_t c = 0; c < fleet.size(); ++c) {
+		if (fleet.idle(c)) idle.emplace_back(c);
+	}
+	if (idle.empty()) return;
+
+	//cost: time to finish the order, with a large penalty for finishing late:
+	// (unreachable pairs get a finite stand-in cost, so the matching stays well-defined, and are dropped afterward)
+	constexpr float LatePenalty = 1000.0f;
+	constexpr float Unreachable = 1.0e6f;
+	auto order_cost = [&](uint32_t o, uint32_t c) {
+		Order const &order = *context.orders.pending_orders_.get(pending[o]);
+		float time = trip_time(context, c, order);
+		if (!std::isfinite(time)) return Unreachable;
+		if (time > order.remaining_time) time += LatePenalty;
+		return std::min(time, Unreachable);
+	};
+
+	//match the smaller side to the larger:
+	uint32_t orders = uint32_t(pending.size());
+	uint32_t couriers = uint32_t(idle.size());
+	bool by_order = (orders <= couriers);
+	uint32_t rows = (by_order ? orders : couriers);
+	uint32_t cols = (by_order ? couriers : orders);
+	std::vector< float > cost(size_t(rows) * cols);
+	for (uint32_t r = 0; r < rows; ++r) {
+		for (uint32_t c = 0; c < cols; ++c) {
+			cost[r * cols + c] = (by_order ? order_cost(r, idle[c]) : order_cost(c, idle[r]));
+		}
+	}
+	std::vector< uint32_t > match = hungarian(cost, rows, cols);
+	for (uint32_t r = 0; r < rows; ++r) {
+		if (cost[r * cols + match[r]] >= Unreachable) continue;
+		uint32_t o = (by_order ? r : match[r]);
+		uint32_t c = (by_order ? idle[match[r]] : idle[r]);
+		assignments->emplace_back(Assignment{pending[o], c, 0, 1});
+	}
+}
+
+//----------------------------------------------------------------
+
+//time to drive 'plan' from 'position', or infinity if a (not yet expired) delivery would be late
+// or a stop can't be reached:
+static float plan_time(DispatchContext const &context, glm::vec3 const &position, std::vector< Fleet::Stop > const &plan) {
+	TravelTimes const &times = context.travel_times;
+	float total = 0.0f;
+	for (uint32_t i = 0; i < plan.size(); ++i) {
+		total += (i == 0 ? times.time(position, plan[i].location) : times.time(plan[i-1].location, plan[i].location));
+		if (!plan[i].pickup
+		 && plan[i].deadline >= context.time //(already-expired orders can't be saved)
+		 && context.time + total > plan[i].deadline) {
+			return std::numeric_limits< float >::infinity();
+		}
+	}
+	return total;
+}
+
+void InsertionDispatcher::dispatch(DispatchContext const &context, std::vector< Assignment > *assignments) {
+	assert(assignments);
+	context.orders.pending_orders_.ids_by_age(&pending);
+	Fleet const &fleet = context.fleet;
+	if (pending.empty()) return;
+
+	//plans changed by this call's earlier insertions (few, so a linear search is fine):
+	std::vector< std::pair< uint32_t, std::vector< Fleet::Stop > > > changed;
+	auto plan_of = [&](uint32_t c) -> std::vector< Fleet::Stop > const & {
+		for (auto const &cp : changed) {
+			if (cp.first == c) return cp.second;
+		}
+		return fleet.stops[c];
+	};
+
+	std::vector< Fleet::Stop > plan;
+	for (OrderId o : pending) {
+		Order const &order = *context.orders.pending_orders_.get(o);
+		Fleet::Stop pickup{order.store, true, 0.0};
+		Fleet::Stop deliver{order.client, false, context.time + order.remaining_time};
+
+		//cheapest feasible insertion over all couriers with room:
+		Assignment best{o, -1U, 0, 0};
+		float best_cost = std::numeric_limits< float >::infinity();
+		//fallback if nothing is feasible: the idle courier that would be least late:
+		Assignment late{o, -1U, 0, 1};
+		float late_time = std::numeric_limits< float >::infinity();
+
+		for (uint32_t c = 0; c < fleet.size(); ++c) {
+			std::vector< Fleet::Stop > const &current = plan_of(c);
+			uint32_t planned = uint32_t(std::count_if(current.begin(), current.end(), [](Fleet::Stop const &s){ return !s.pickup; }));
+			if (planned >= capacity) continue;
+
+			if (current.empty()) {
+				//(only one way to insert into an empty plan)
+				float time = trip_time(context, c, order);
+				if (!std::isfinite(time)) continue; //(can't reach the store or client)
+				if (time <= order.remaining_time) {
+					if (time < best_cost) {
+						best_cost = time;
+						best = Assignment{o, c, 0, 1};
+					}
+				} else if (time < late_time) {
+					late_time = time;
+					late.courier = c;
+				}
+				continue;
+			}
+
+			float before = plan_time(context, fleet.position[c], current);
+			if (!std::isfinite(before)) {
+				//(plan is already going to be late, or can't be driven; don't add to it)
+				continue;
+			}
+			for (uint32_t p = 0; p <= current.size(); ++p) {
+				for (uint32_t d = p + 1; d <= current.size() + 1; ++d) {
+					plan = current;
+					plan.insert(plan.begin() + p, pickup);
+					plan.insert(plan.begin() + d, deliver);
+					float cost = plan_time(context, fleet.position[c], plan) - before;
+					if (!std::isfinite(cost)) continue; //(late or unreachable)
+					if (cost < best_cost) {
+						best_cost = cost;
+						best = Assignment{o, c, p, d};
+					}
+				}
+			}
+		}
+
+		if (best.courier == -1U) best = late;
+		if (best.courier == -1U) continue; //nobody can take it this tick
+
+		//record the insertion so later orders see it:
+		plan = plan_of(best.courier);
+		plan.insert(plan.begin() + best.pickup_at, pickup);
+		plan.insert(plan.begin() + best.deliver_at, deliver);
+		bool found = false;
+		for (auto &cp : changed) {
+			if (cp.first == best.courier) {
+				cp.second = plan;
+				found = true;
+			}
+		}
+		if (!found) changed.emplace_back(best.courier, plan);
+
+		assignments->emplace_back(best);
+	}
+}
+
+void HungarianDispatcher::get_state(std::vector< double > *state) const {
+	state->assign(1, next_batch);
+}
+
+void HungarianDispatcher::set_state(std::vector< double > const &state) {
+	if (state.size() != 1) throw std::runtime_error("Saved hungarian dispatcher state has the wrong size.");
+	next_batch = state[0];
+}
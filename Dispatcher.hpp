@@ -0,0 +1,92 @@
+#pragma once
+
+/*
+ * A Dispatcher decides which courier carries which pending order.
+ *
+ * Simulation calls dispatch() every tick; a dispatcher looks at the pending
+ *  orders (oldest first) and the couriers' current plans (Fleet::stops) and returns
+ *  assignments, each of which inserts a pickup and a delivery stop into one
+ *  courier's plan. Orders left unassigned stay pending for a later tick.
+ *
+ * Dispatchers:
+ *  - "greedy": oldest order first, to the idle courier that reaches the store soonest
+ *  - "hungarian": every batch_interval seconds, optimally match pending orders to idle couriers
+ *  - "insertion": cheapest feasible insertion into any courier's plan (couriers carry several orders)
+ */
+
+#include "OrderController.hpp"
+#include "Fleet.hpp"
+#include "TravelTimes.hpp"
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+//everything a dispatcher gets to look at:
+struct DispatchContext {
+	double time; //current simulation time
+	OrderController const &orders;
+	Fleet const &fleet;
+	TravelTimes const &travel_times;
+};
+
+struct Assignment {
+	OrderId order; //in orders.pending_orders_
+	uint32_t courier;
+	//insert the pickup stop before stops[pickup_at], then the delivery stop before stops[deliver_at]
+	// (deliver_at counts the just-inserted pickup, so pickup_at < deliver_at):
+	// indices refer to the plan as modified by earlier assignments in the same list.
+	uint32_t pickup_at;
+	uint32_t deliver_at;
+};
+
+struct Dispatcher {
+	virtual ~Dispatcher() { }
+
+	//append assignments (each pending order at most once) for this tick:
+	virtual void dispatch(DispatchContext const &context, std::vector< Assignment > *assignments) = 0;
+
+	//write / restore dispatcher state (e.g. batch timing) as a chunk:
+	// (any dispatcher can load any other's state -- so a snapshot can be continued with a different dispatcher --
+	//  and starts fresh if the state isn't its own)
+	void save(std::ostream *to) const;
+	void load(std::istream &from);
+
+	//make a dispatcher by name ("greedy", "hungarian", "insertion"); throws on unknown names:
+	static std::unique_ptr< Dispatcher > make(std::string const &name);
+
+protected:
+	//state for save / load, as a name and a few numbers:
+	virtual std::string state_name() const { return ""; }
+	virtual void get_state(std::vector< double > *) const { }
+	virtual void set_state(std::vector< double > const &) { }
+
+	//pending order ids, oldest first (scratch space refilled by dispatch()):
+	std::vector< OrderId > pending;
+};
+
+struct GreedyDispatcher : Dispatcher {
+	virtual void dispatch(DispatchContext const &context, std::vector< Assignment > *assignments) override;
+};
+
+struct HungarianDispatcher : Dispatcher {
+	virtual void dispatch(DispatchContext const &context, std::vector< Assignment > *assignments) override;
+
+	//seconds between batches (orders wait for the next batch):
+	float batch_interval = 2.0f;
+	double next_batch = 0.0;
+
+protected:
+	virtual std::string state_name() const override { return "hungarian"; }
+	virtual void get_state(std::vector< double > *state) const override;
+	virtual void set_state(std::vector< double > const &state) override;
+};
+
+struct InsertionDispatcher : Dispatcher {
+	virtual void dispatch(DispatchContext const &context, std::vector< Assignment > *assignments) override;
+
+	//most orders a courier has planned at once:
+	uint32_t capacity = 3;
+};
@@ -0,0 +1,96 @@
+#include "EventRecorder.hpp"
+
+#include "read_write_chunk.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+static std::atomic< uint64_t > next_recorder_id{1};
+
+EventRecorder::EventRecorder(std::string const &filename_, uint32_t ring_capacity_)
+	: filename(filename_), id(next_recorder_id.fetch_add(1)), ring_capacity(1), file(filename_, std::ios::binary) {
+	if (!file) throw std::runtime_error("Failed to open event file '" + filename + "' for writing.");
+	while (ring_capacity < ring_capacity_) ring_capacity *= 2;
+	write_chunk("evh0", std::vector< EventFileHeader >{EventFileHeader()}, &file);
+	flusher = std::thread(&EventRecorder::flush_loop, this);
+}
+
+EventRecorder::~EventRecorder() {
+	{
+		std::unique_lock< std::mutex > lock(stop_mutex);
+		stop = true;
+	}
+	stop_cv.notify_all();
+	flusher.join();
+	if (dropped() > 0) {
+		std::cerr << "WARNING: dropped " << dropped() << " events (rings full) while recording '" << filename << "'." << std::endl;
+	}
+}
+
+uint64_t EventRecorder::dropped() const {
+	uint64_t total = 0;
+	std::unique_lock< std::mutex > lock(rings_mutex);
+	for (auto const &ring : rings) total += ring->dropped.load(std::memory_order_relaxed);
+	return total;
+}
+
+EventRecorder::Ring &EventRecorder::ring_for_this_thread() {
+	//each thread remembers its ring in every recorder it has used:
+	// (ids are never reused, so entries for destroyed recorders are just never matched again)
+	thread_local std::vector< std::pair< uint64_t, Ring * > > cache;
+	for (auto const &entry : cache) {
+		if (entry.first == id) return *entry.second;
+	}
+	std::unique_lock< std::mutex > lock(rings_mutex);
+	rings.emplace_back(std::make_unique< Ring >(ring_capacity));
+	cache.emplace_back(id, rings.back().get());
+	return *rings.back();
+}
+
+void EventRecorder::record(EventRecord const &event) {
+	Ring &ring = ring_for_this_thread();
+	uint64_t head = ring.head.load(std::memory_order_relaxed);
+	if (head - ring.tail.load(std::memory_order_acquire) > ring.mask) {
+		ring.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	ring.slots[head & ring.mask] = event;
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+void EventRecorder::drain(std::vector< EventRecord > *batch) {
+	std::unique_lock< std::mutex > lock(rings_mutex);
+	for (auto &ring_ptr : rings) {
+		Ring &ring = *ring_ptr;
+		uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+		uint64_t head = ring.head.load(std::memory_order_acquire);
+		for (uint64_t i = tail; i < head; ++i) {
+			batch->emplace_back(ring.slots[i & ring.mask]);
+		}
+		ring.tail.store(head, std::memory_order_release);
+	}
+}
+
+void EventRecorder::flush_loop() {
+	std::vector< EventRecord > batch;
+	bool stopping = false;
+	while (!stopping) {
+		{
+			std::unique_lock< std::mutex > lock(stop_mutex);
+			stop_cv.wait_for(lock, std::chrono::milliseconds(10), [this](){ return stop; });
+			stopping = stop;
+		}
+		//(after 'stop' is seen, producers are done, so this drain gets everything)
+		batch.clear();
+		drain(&batch);
+		if (batch.empty()) continue;
+		write_chunk("evt0", batch, &file);
+		if (!file) {
+			std::cerr << "WARNING: failed to write events to '" << filename << "'; recording stopped." << std::endl;
+			return;
+		}
+		written_.fetch_add(batch.size(), std::memory_order_relaxed);
+	}
+	file.flush();
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+/*
+ * EventRecorder captures what happens during a run (orders created / accepted /
+ *  picked up / delivered / expired / cancelled, couriers moving, mode switches)
+ *  as fixed-size binary records.
+ *
+ * record() never blocks or allocates after a thread's first call: each thread
+ *  writes into its own single-producer / single-consumer ring, and a background
+ *  thread drains the rings to disk. If a ring fills (the disk can't keep up),
+ *  new records are dropped and counted rather than stalling the caller.
+ *
+ * The file is a sequence of read_write_chunk.hpp chunks:
+ *   evh0 len < EventFileHeader > [one header]
+ *   evt0 len < EventRecord > * [repeated; records from different threads may interleave, so sort by time if order matters]
+ */
+
+#include "OrderPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class EventType : uint32_t {
+	OrderCreated,
+	OrderAccepted,
+	OrderPickedUp,
+	OrderDelivered,
+	OrderExpired,
+	OrderCancelled,
+	CourierMoved,
+	ModeSwitched,
+};
+
+struct EventRecord {
+	double time; //simulation seconds
+	EventType type;
+	uint32_t courier; //(order events: the order's courier)
+	OrderId order; //(order events only)
+	glm::vec3 position; //where it happened
+	uint32_t data; //order events: Location; CourierMoved: next waypoint; ModeSwitched: 1 if now driving
+};
+static_assert(sizeof(EventRecord) == 8 + 4 + 4 + 8 + 12 + 4, "EventRecord is packed.");
+
+struct EventFileHeader {
+	uint32_t version = 1;
+	uint32_t record_size = sizeof(EventRecord);
+};
+
+struct EventRecorder {
+	//opens (truncates) 'filename' and starts the flush thread; throws if the file can't be opened:
+	// 'ring_capacity' (records per thread) is rounded up to a power of two.
+	explicit EventRecorder(std::string const &filename, uint32_t ring_capacity = 1 << 16);
+	~EventRecorder(); //drains every ring and closes the file
+
+	EventRecorder(EventRecorder const &) = delete;
+	EventRecorder &operator=(EventRecorder const &) = delete;
+
+	//thread-safe; wait-free except for the first call on each thread:
+	void record(EventRecord const &event);
+
+	//records written to disk / dropped because a ring was full:
+	uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+	uint64_t dropped() const;
+
+	std::string filename;
+
+private:
+	struct Ring {
+		explicit Ring(uint32_t capacity) : slots(capacity), mask(capacity - 1) { }
+		std::vector< EventRecord > slots;
+		uint64_t mask;
+		alignas(64) std::atomic< uint64_t > head{0}; //next slot to write (producer)
+		alignas(64) std::atomic< uint64_t > tail{0}; //next slot to read (consumer)
+		std::atomic< uint64_t > dropped{0};
+	};
+	Ring &ring_for_this_thread();
+	void drain(std::vector< EventRecord > *batch);
+	void flush_loop();
+
+	uint64_t id; //distinguishes recorders in per-thread ring caches
+	uint32_t ring_capacity;
+	mutable std::mutex rings_mutex; //guards 'rings' (taken when a thread registers, and while draining)
+	std::vector< std::unique_ptr< Ring > > rings;
+
+	std::ofstream file;
+	std::atomic< uint64_t > written_{0};
+	std::mutex stop_mutex;
+	std::condition_variable stop_cv;
+	bool stop = false;
+	std::thread flusher;
+};
@@ -0,0 +1,177 @@
+#include "Fleet.hpp"
+
+#include "read_write_chunk.hpp"
+
+#include <glm/gtx/norm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+
+Fleet::Fleet(WalkMesh const &walkmesh_) : walkmesh(walkmesh_), router(walkmesh_) {
+}
+
+uint32_t Fleet::add_courier(WalkPoint const &start) {
+	uint32_t index = size();
+	at.emplace_back(start);
+	position.emplace_back(walkmesh.to_world_point(start));
+	speed.emplace_back(0.0f);
+	stops.emplace_back();
+	target.emplace_back(position.back());
+	route.emplace_back();
+	waypoint.emplace_back(0);
+	return index;
+}
+
+uint32_t Fleet::add_courier(glm::vec3 const &start) {
+	return add_courier(walkmesh.nearest_walk_point(start));
+}
+
+void Fleet::set_target(uint32_t i, glm::vec3 const &destination) {
+	assert(i < size());
+	target[i] = destination;
+	waypoint[i] = 0;
+	if (!router.route(at[i], destination, &route[i])) {
+		//unreachable; fall back to steering straight at the destination:
+		route[i].points.assign(1, destination);
+	}
+}
+
+void Fleet::update(float elapsed, ThreadPool *pool) {
+	if (pool) {
+		pool->parallel_for(size(), UpdateGrain, [this, elapsed](uint32_t begin, uint32_t end){
+			update_range(begin, end, elapsed);
+		});
+	} else {
+		update_range(0, size(), elapsed);
+	}
+	time += elapsed;
+}
+
+void Fleet::update_range(uint32_t begin, uint32_t end, float elapsed) {
+	assert(begin <= end && end <= size());
+	for (uint32_t i = begin; i < end; ++i) {
+		if (idle(i)) {
+			speed[i] = 0.0f;
+			continue;
+		}
+
+		std::vector< glm::vec3 > const &points = route[i].points;
+		if (waypoint[i] >= points.size()) {
+			//end of route:
+			speed[i] = 0.0f;
+			continue;
+		}
+
+		//steer straight at the next corner of the route, along the surface:
+		glm::vec3 up = walkmesh.to_world_smooth_normal(at[i]);
+		glm::vec3 to_target = points[waypoint[i]] - position[i];
+		to_target -= glm::dot(to_target, up) * up;
+		float dis = glm::length(to_target);
+
+		speed[i] = std::min(max_speed, speed[i] + acceleration * elapsed);
+		float move = speed[i] * elapsed;
+		if (dis <= move) waypoint[i] += 1; //(corner reached this step)
+		if (dis == 0.0f) continue;
+		glm::vec3 step = to_target * (std::min(dis, move) / dis);
+
+		glm::vec3 before = position[i];
+		walkmesh.walk(&at[i], step);
+		position[i] = walkmesh.to_world_point(at[i]);
+		//pinned against a wall (e.g. bounced off a corner onto the far side of the next leg)?
+		// route again from where the courier actually is:
+		if (dis > move && glm::distance(position[i], before) < 0.25f * move) {
+			set_target(i, target[i]);
+		}
+		if (recorder) {
+			recorder->record(EventRecord{time + elapsed, EventType::CourierMoved, i, OrderId(), position[i], waypoint[i]});
+		}
+	}
+}
+
+bool Fleet::at_target(uint32_t i, float dis) const {
+	//(targets off the walkmesh count as reached once the route ends at the nearest walk point)
+	return glm::length2(target[i] - position[i]) < dis * dis
+	    || (!idle(i) && waypoint[i] >= route[i].points.size());
+}
+
+struct FleetState {
+	double time;
+	uint32_t couriers;
+	uint32_t triangles; //(walkmesh check)
+};
+
+//saved form of a Stop (no padding, so equal plans save to equal bytes):
+struct StopRecord {
+	double deadline;
+	uint32_t location; //Location
+	uint32_t pickup; //0 or 1
+	uint32_t order_slot;
+	uint32_t order_generation;
+};
+static_assert(sizeof(StopRecord) == 8 + 4 * 4, "StopRecord is packed.");
+static_assert(std::is_trivially_copyable< StopRecord >::value, "StopRecords are saved as raw bytes.");
+
+void Fleet::save(std::ostream *to) const {
+	std::vector< std::vector< StopRecord > > stop_records;
+	stop_records.reserve(stops.size());
+	for (auto const &plan : stops) {
+		stop_records.emplace_back();
+		for (Stop const &s : plan) {
+			stop_records.back().emplace_back(StopRecord{s.deadline, uint32_t(s.location), s.pickup ? 1U : 0U, s.order.slot, s.order.generation});
+		}
+	}
+	write_chunk_value("flt0", FleetState{time, size(), uint32_t(walkmesh.triangles.size())}, to);
+	write_chunk("fla0", at, to);
+	write_chunk("flp0", position, to);
+	write_chunk("flv0", speed, to);
+	write_nested_chunks("fls0", "fls2", stop_records, to);
+	write_chunk("flt1", target, to);
+	std::vector< std::vector< glm::vec3 > > points;
+	std::vector< float > lengths;
+	for (auto const &r : route) {
+		points.emplace_back(r.points);
+		lengths.emplace_back(r.length);
+	}
+	write_nested_chunks("flr0", "flr1", points, to);
+	write_chunk("flr2", lengths, to);
+	write_chunk("flw0", waypoint, to);
+}
+
+void Fleet::load(std::istream &from) {
+	FleetState state = read_chunk_value< FleetState >(from, "flt0");
+	if (state.triangles != walkmesh.triangles.size()) {
+		throw std::runtime_error("Saved fleet is on a different walkmesh.");
+	}
+	std::vector< std::vector< glm::vec3 > > points;
+	std::vector< float > lengths;
+	std::vector< std::vector< StopRecord > > stop_records;
+	read_chunk(from, "fla0", &at);
+	read_chunk(from, "flp0", &position);
+	read_chunk(from, "flv0", &speed);
+	read_nested_chunks(from, "fls0", "fls2", &stop_records);
+	read_chunk(from, "flt1", &target);
+	read_nested_chunks(from, "flr0", "flr1", &points);
+	read_chunk(from, "flr2", &lengths);
+	read_chunk(from, "flw0", &waypoint);
+
+	uint32_t n = state.couriers;
+	if (at.size() != n || position.size() != n || speed.size() != n || stop_records.size() != n
+	 || target.size() != n || points.size() != n || lengths.size() != n || waypoint.size() != n) {
+		throw std::runtime_error("Saved fleet has mismatched courier counts.");
+	}
+	for (WalkPoint const &wp : at) {
+		if (wp.triangle >= walkmesh.triangles.size()) throw std::runtime_error("Saved fleet has a courier off the walkmesh.");
+	}
+	route.resize(n);
+	stops.resize(n);
+	for (uint32_t i = 0; i < n; ++i) {
+		route[i].points = std::move(points[i]);
+		route[i].length = lengths[i];
+		stops[i].clear();
+		for (StopRecord const &r : stop_records[i]) {
+			stops[i].emplace_back(Stop{Location(r.location), r.pickup != 0, r.deadline, OrderId{r.order_slot, r.order_generation}});
+		}
+	}
+	time = state.time;
+}
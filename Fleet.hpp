@@ -0,0 +1,87 @@
+#pragma once
+
+/*
+ * A Fleet is a group of couriers moving over one WalkMesh.
+ *
+ * Courier state is kept in parallel arrays (structure-of-arrays), indexed by
+ *  courier number, so the per-tick movement update is a linear pass over
+ *  contiguous memory rather than a walk over Scene::Transform pointers.
+ */
+
+#include "WalkMesh.hpp"
+#include "OrderModels.hpp"
+#include "OrderPool.hpp"
+#include "Router.hpp"
+#include "ThreadPool.hpp"
+#include "EventRecorder.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+struct Fleet {
+	Fleet(WalkMesh const &walkmesh);
+
+	//add a courier (standing still, with no stops) and return its index:
+	uint32_t add_courier(WalkPoint const &start);
+	uint32_t add_courier(glm::vec3 const &start); //(looks up nearest walk point)
+
+	uint32_t size() const { return uint32_t(at.size()); }
+	bool idle(uint32_t i) const { return stops[i].empty(); }
+
+	//send courier 'i' to 'destination' along a route over the walkmesh:
+	void set_target(uint32_t i, glm::vec3 const &destination);
+
+	//move every courier along its route for 'elapsed' seconds:
+	// if 'pool' is given, couriers are moved in parallel; each courier only reads
+	// the (const) walkmesh and writes its own slots, so results match the serial update.
+	void update(float elapsed, ThreadPool *pool = nullptr);
+
+	//move couriers [begin, end) (the per-chunk body of update()):
+	void update_range(uint32_t begin, uint32_t end, float elapsed);
+
+	//couriers per parallel chunk (fixed, so chunking doesn't depend on thread count):
+	static constexpr uint32_t UpdateGrain = 256;
+
+	//write / restore every courier's state as chunks (load into a fleet on the same walkmesh; throws on format errors):
+	void save(std::ostream *to) const;
+	void load(std::istream &from);
+
+	//is courier 'i' within 'dis' of its target (or as close as the walkmesh allows)?
+	bool at_target(uint32_t i, float dis) const;
+
+	//vehicle tuning (shared by all couriers; matches PlayMode's car):
+	float max_speed = 4.0f;
+	float acceleration = 4.0f;
+
+	WalkMesh const &walkmesh;
+	Router router;
+
+	//seconds of update() so far (timestamps recorded events):
+	double time = 0.0;
+	//(optional) receives a CourierMoved event per moving courier per update; not owned:
+	EventRecorder *recorder = nullptr;
+
+	//a stop on a courier's plan:
+	struct Stop {
+		Location location;
+		bool pickup; //pick up at a store (otherwise, deliver to a client)
+		double deadline; //simulation time the order expires (deliveries only)
+		OrderId order; //in the accepted pool (stops whose order has expired are dropped by Simulation)
+	};
+
+	//----- per-courier state -----
+	//location on the walkmesh (and cached world position):
+	std::vector< WalkPoint > at;
+	std::vector< glm::vec3 > position;
+	//vehicle state:
+	std::vector< float > speed;
+	//assigned work (stops[i].front() is the stop courier 'i' is driving to; empty when idle):
+	std::vector< std::vector< Stop > > stops;
+	std::vector< glm::vec3 > target;
+	//route to target (points[waypoint] is the next corner to steer at):
+	std::vector< Route > route;
+	std::vector< uint32_t > waypoint;
+};
@@ -14,6 +14,7 @@ Load< LitColorTextureProgram > lit_color_texture_program(LoadTagEarly, []() -> L
 	lit_color_texture_program_pipeline.OBJECT_TO_CLIP_mat4 = ret->OBJECT_TO_CLIP_mat4;
 	lit_color_texture_program_pipeline.OBJECT_TO_LIGHT_mat4x3 = ret->OBJECT_TO_LIGHT_mat4x3;
 	lit_color_texture_program_pipeline.NORMAL_TO_LIGHT_mat3 = ret->NORMAL_TO_LIGHT_mat3;
+	lit_color_texture_program_pipeline.INSTANCE_BASE_int = ret->INSTANCE_BASE_int;
 
 	/* This will be used later if/when we build a light loop into the Scene:
 	lit_color_texture_program_pipeline.LIGHT_TYPE_int = ret->LIGHT_TYPE_int;
@@ -51,6 +52,8 @@ LitColorTextureProgram::LitColorTextureProgram() {
 		"uniform mat4 OBJECT_TO_CLIP;\n"
 		"uniform mat4x3 OBJECT_TO_LIGHT;\n"
 		"uniform mat3 NORMAL_TO_LIGHT;\n"
+		"uniform samplerBuffer INSTANCES;\n"
+		"uniform int INSTANCE_BASE;\n"
 		"in vec4 Position;\n"
 		"in vec3 Normal;\n"
 		"in vec4 Color;\n"
@@ -60,9 +63,18 @@ LitColorTextureProgram::LitColorTextureProgram() {
 		"out vec4 color;\n"
 		"out vec2 texCoord;\n"
 		"void main() {\n"
-		"	gl_Position = OBJECT_TO_CLIP * Position;\n"
-		"	position = OBJECT_TO_LIGHT * Position;\n"
-		"	normal = NORMAL_TO_LIGHT * Normal;\n"
+		"	mat4 object_to_clip = OBJECT_TO_CLIP;\n"
+		"	mat4x3 object_to_light = OBJECT_TO_LIGHT;\n"
+		"	mat3 normal_to_light = NORMAL_TO_LIGHT;\n"
+		"	if (INSTANCE_BASE >= 0) { //instanced: 11 texels per instance, laid out as in Scene.hpp \n"
+		"		int t = (INSTANCE_BASE + gl_InstanceID) * 11;\n"
+		"		object_to_clip = mat4(texelFetch(INSTANCES, t+0), texelFetch(INSTANCES, t+1), texelFetch(INSTANCES, t+2), texelFetch(INSTANCES, t+3));\n"
+		"		object_to_light = mat4x3(texelFetch(INSTANCES, t+4).xyz, texelFetch(INSTANCES, t+5).xyz, texelFetch(INSTANCES, t+6).xyz, texelFetch(INSTANCES, t+7).xyz);\n"
+		"		normal_to_light = mat3(texelFetch(INSTANCES, t+8).xyz, texelFetch(INSTANCES, t+9).xyz, texelFetch(INSTANCES, t+10).xyz);\n"
+		"	}\n"
+		"	gl_Position = object_to_clip * Position;\n"
+		"	position = object_to_light * Position;\n"
+		"	normal = normal_to_light * Normal;\n"
 		"	color = Color;\n"
 		"	texCoord = TexCoord;\n"
 		"}\n"
@@ -119,6 +131,7 @@ LitColorTextureProgram::LitColorTextureProgram() {
 	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
 	OBJECT_TO_LIGHT_mat4x3 = glGetUniformLocation(program, "OBJECT_TO_LIGHT");
 	NORMAL_TO_LIGHT_mat3 = glGetUniformLocation(program, "NORMAL_TO_LIGHT");
+	INSTANCE_BASE_int = glGetUniformLocation(program, "INSTANCE_BASE");
 
 	LIGHT_TYPE_int = glGetUniformLocation(program, "LIGHT_TYPE");
 	LIGHT_LOCATION_vec3 = glGetUniformLocation(program, "LIGHT_LOCATION");
@@ -128,11 +141,14 @@ LitColorTextureProgram::LitColorTextureProgram() {
 
 
 	GLuint TEX_sampler2D = glGetUniformLocation(program, "TEX");
+	GLuint INSTANCES_samplerBuffer = glGetUniformLocation(program, "INSTANCES");
 
 	//set TEX to always refer to texture binding zero:
 	glUseProgram(program); //bind program -- glUniform* calls refer to this program now
 
 	glUniform1i(TEX_sampler2D, 0); //set TEX to sample from GL_TEXTURE0
+	glUniform1i(INSTANCES_samplerBuffer, Scene::Drawable::Pipeline::InstanceTextureUnit); //set INSTANCES to sample from GL_TEXTURE4
+	glUniform1i(INSTANCE_BASE_int, -1); //not instanced unless Scene::draw says so
 
 	glUseProgram(0); //unbind program -- glUniform* calls refer to ??? now
 }
@@ -21,6 +21,7 @@ struct LitColorTextureProgram {
 	GLuint OBJECT_TO_CLIP_mat4 = -1U;
 	GLuint OBJECT_TO_LIGHT_mat4x3 = -1U;
 	GLuint NORMAL_TO_LIGHT_mat3 = -1U;
+	GLuint INSTANCE_BASE_int = -1U; //>= 0 => read the three matrices above from INSTANCES instead (see Scene::Drawable::Pipeline)
 
 	//lighting:
 	GLuint LIGHT_TYPE_int = -1U;
@@ -31,6 +32,7 @@ struct LitColorTextureProgram {
 	
 	//Textures:
 	//TEXTURE0 - texture that is accessed by TexCoord
+	//TEXTURE4 - per-instance matrices (samplerBuffer, filled by Scene::draw)
 };
 
 extern Load< LitColorTextureProgram > lit_color_texture_program;
@@ -0,0 +1,104 @@
+#include "LocationCatalog.hpp"
+
+#include "OrderModels.hpp"
+#include "read_write_chunk.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+LocationCatalog LocationCatalog::builtin() {
+	LocationCatalog ret;
+	//(in enum order, so Location::STORE_CHEESECAKE etc. index these)
+	ret.add("Cheesecake Workshop", glm::vec3(-3.0f, -3.0f, 0.0f), glm::u8vec4(0xEB, 0xE1, 0x60, 0xff), true);
+	ret.add("Tartan Pancakes", glm::vec3(17.0f, 0.0f, 0.0f), glm::u8vec4(0xC0, 0xDF, 0xDD, 0xff), true);
+	ret.add("client1", glm::vec3(-9.0f, 11.0f, 0.0f), glm::u8vec4(0xc4, 0xfa, 0x89, 0xff), false);
+	ret.add("client2", glm::vec3(6.0f, 11.0f, 0.0f), glm::u8vec4(0x44, 0xbd, 0xd8, 0xff), false);
+	ret.add("client3", glm::vec3(10.0f, -11.0f, 0.0f), glm::u8vec4(0xea, 0xe8, 0x61, 0xff), false);
+	ret.add("client4", glm::vec3(7.0f, 2.0f, 0.0f), glm::u8vec4(0xff, 0x91, 0x9a, 0xff), false);
+	return ret;
+}
+
+void LocationCatalog::add(std::string const &name, glm::vec3 const &position, glm::u8vec4 const &color, bool store) {
+	Location loc = Location(size());
+	positions.emplace_back(position);
+	colors.emplace_back(color);
+	name_chars.insert(name_chars.end(), name.begin(), name.end());
+	name_ends.emplace_back(uint32_t(name_chars.size()));
+	is_store.emplace_back(store);
+	(store ? stores : clients).emplace_back(loc);
+}
+
+void LocationCatalog::clear() {
+	*this = LocationCatalog();
+}
+
+void LocationCatalog::read(std::istream &from, std::vector< char > const &str0) {
+	struct LocationEntry {
+		uint32_t name_begin;
+		uint32_t name_end;
+		glm::vec3 position;
+		glm::u8vec4 color;
+		uint32_t kind;
+	};
+	static_assert(sizeof(LocationEntry) == 4 + 4 + 4*3 + 4 + 4, "LocationEntry is packed.");
+	std::vector< LocationEntry > entries;
+	read_chunk(from, "loc0", &entries);
+
+	clear();
+	for (auto const &e : entries) {
+		if (!(e.name_begin <= e.name_end && e.name_end <= str0.size())) {
+			throw std::runtime_error("location entry has invalid name indices");
+		}
+		if (e.kind > 1) {
+			throw std::runtime_error("location entry has unknown kind (" + std::to_string(e.kind) + ")");
+		}
+		add(std::string(str0.begin() + e.name_begin, str0.begin() + e.name_end), e.position, e.color, e.kind == 0);
+	}
+	if (stores.empty() || clients.empty()) {
+		throw std::runtime_error("location chunk needs at least one store and one client");
+	}
+}
+
+LocationCatalog LocationCatalog::from_scene_file(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("failed to open scene file '" + filename + "'");
+
+	std::vector< char > names;
+	read_chunk(file, "str0", &names);
+
+	//skip the standard chunks (see Scene::load):
+	for (char const *magic : {"xfh0", "msh0", "cam0", "lmp0"}) {
+		struct ChunkHeader {
+			char magic[4] = {'\0', '\0', '\0', '\0'};
+			uint32_t size = 0;
+		};
+		static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+		ChunkHeader header;
+		if (!file.read(reinterpret_cast< char * >(&header), sizeof(header))) {
+			throw std::runtime_error("scene file '" + filename + "' ended before '" + magic + "' chunk");
+		}
+		if (std::string(header.magic, 4) != magic) {
+			throw std::runtime_error("scene file '" + filename + "' has unexpected chunk where '" + magic + "' should be");
+		}
+		file.seekg(header.size, std::ios::cur);
+	}
+
+	LocationCatalog ret = builtin();
+	if (file.peek() != EOF) {
+		ret.read(file, names);
+	}
+	return ret;
+}
+
+static LocationCatalog &current_catalog() {
+	static LocationCatalog catalog = LocationCatalog::builtin();
+	return catalog;
+}
+
+LocationCatalog const &get_location_catalog() {
+	return current_catalog();
+}
+
+void set_location_catalog(LocationCatalog const &catalog) {
+	current_catalog() = catalog;
+}
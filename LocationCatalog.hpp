@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ * LocationCatalog is the table of stores and clients orders travel between.
+ *
+ * Locations are numbered 0 .. size()-1 (as Location values); per-location data
+ *  is kept in parallel arrays. The built-in catalog holds the six locations
+ *  named in the Location enum; a scene file may replace it with a "loc0" chunk
+ *  (written by scenes/export-scene.py) following the standard scene chunks:
+ *
+ *   loc0 len < uint name_begin, uint name_end, vec3 position, u8vec4 color, uint kind >
+ *     names index the scene's str0 chunk; kind is 0 for a store, 1 for a client
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+enum class Location : uint32_t;
+
+struct LocationCatalog {
+	//the six built-in locations:
+	static LocationCatalog builtin();
+
+	//read a "loc0" chunk ('str0' is the scene's string table); throws on format errors:
+	void read(std::istream &from, std::vector< char > const &str0);
+
+	//read the locations from a scene file without loading the scene (no OpenGL needed):
+	// returns the built-in catalog if the scene has no "loc0" chunk; throws on format errors.
+	static LocationCatalog from_scene_file(std::string const &filename);
+
+	uint32_t size() const { return uint32_t(positions.size()); }
+
+	void add(std::string const &name, glm::vec3 const &position, glm::u8vec4 const &color, bool store);
+	void clear();
+
+	//per-location data, indexed by Location:
+	std::vector< glm::vec3 > positions;
+	std::vector< glm::u8vec4 > colors;
+	std::vector< uint32_t > name_ends; //name of location i is name_chars[name_ends[i-1] (or 0), name_ends[i])
+	std::vector< char > name_chars;
+	std::vector< bool > is_store;
+
+	//all stores / all clients (for picking at random):
+	std::vector< Location > stores;
+	std::vector< Location > clients;
+};
+
+//catalog used by get_location_position() and friends (the built-in one until set):
+LocationCatalog const &get_location_catalog();
+void set_location_catalog(LocationCatalog const &catalog);
@@ -14,7 +14,8 @@ struct Mode : std::enable_shared_from_this< Mode > {
 	virtual bool handle_event(SDL_Event const &, glm::uvec2 const &window_size) { return false; }
 
 	//update is called at the start of a new frame, after events are handled:
-	// 'elapsed' is time in seconds since the last call to 'update'
+	// 'elapsed' is the simulated time in seconds covered by this call
+	// (main.cpp calls this with SimClock's fixed step, possibly several times per frame)
 	virtual void update(float elapsed) { }
 
 	//draw is called after update:
@@ -1,71 +1,122 @@
 #include "OrderController.hpp"
-#include <iterator>
-#include "random.hpp"
-void OrderController::draw() {
-	view->draw();
+
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <random>
+#include <type_traits>
+
+//orders deadlines_ as a min-heap:
+static bool later_deadline(std::pair< double, OrderId > const &a, std::pair< double, OrderId > const &b) {
+	return a.first > b.first;
 }
-OrderController::OrderController() {
-	view = std::make_shared<view::OrderSideBarView>();
+OrderController::OrderController() : OrderController(std::random_device{}()) {
 //	Order o1{Location::STORE1, Location::CLIENT1, false, false, 10, 60.0f};
 //	Order o2{Location::STORE2, Location::CLIENT1, false, false, 10, 60.0f};
 //	Order o3{Location::STORE2, Location::CLIENT2, true, false, 10, 60.0f};
 //	pending_orders_.push_back(o1);
 //	pending_orders_.push_back(o2);
 //	accepted_orders_.push_back(o3);
-	view->set_pending_orders(pending_orders_);
-	view->set_accepted_orders(accepted_orders_);
-}
-bool OrderController::handle_keypress(SDL_Keycode key) {
-	if (key==SDLK_RETURN) {
-		std::pair<int, int> focus = view->get_focus();
-		if (focus.first==0 && focus.second < (int) pending_orders_.size()) {
-			Order o = pending_orders_.at(focus.second);
-			o.is_accepted = true;
-			o.is_delivering = false;
-			pending_orders_.erase(std::next(pending_orders_.begin(), focus.second));
-			accepted_orders_.push_back(o);
-			view->set_pending_orders(pending_orders_);
-			view->set_accepted_orders(accepted_orders_);
-			return true;
-		} else {
-			return false;
-		}
-	} else {
-		return view->handle_keypress(key);
+}
+OrderController::OrderController(uint32_t seed_value) {
+	seed(seed_value);
+}
+void OrderController::seed(uint32_t value) {
+	demand_.seed(value);
+	demand_start_ = time_;
+}
+void OrderController::replay(std::string const &trace_path) {
+	replay_ = std::make_unique< OrderTraceReader >(trace_path);
+	demand_start_ = time_;
+}
+void OrderController::record(std::string const &trace_path) {
+	record_ = std::make_unique< OrderTraceWriter >(trace_path);
+	record_start_ = time_;
+}
+bool OrderController::accept_pending_order(OrderId id, uint32_t courier, OrderId *accepted) {
+	Order const *pending = pending_orders_.get(id);
+	if (!pending) return false;
+	Order o = *pending;
+	o.is_accepted = true;
+	o.is_delivering = false;
+	o.courier = courier;
+	o.deadline = time_ + o.remaining_time;
+	pending_orders_.erase(id);
+	OrderId accepted_id = accepted_orders_.insert(o);
+	deadlines_.emplace_back(o.deadline, accepted_id);
+	std::push_heap(deadlines_.begin(), deadlines_.end(), later_deadline);
+	if (waiting_at_.size() < get_location_count()) {
+		waiting_at_.resize(get_location_count());
+		delivering_to_.resize(get_location_count());
 	}
-
+	waiting_at_[uint32_t(o.store)].emplace_back(accepted_id);
+	record_event(EventType::OrderAccepted, time_, accepted_id, o, o.store);
+	if (accepted) *accepted = accepted_id;
+	return true;
 }
 
-void OrderController::pickup_order(Location store) {
-	for (auto &o : accepted_orders_) {
-		if (o.store==store) {
-			o.is_delivering = true;
+void OrderController::pickup_order(Location store, uint32_t courier) {
+	if (uint32_t(store) >= waiting_at_.size()) return;
+	auto &waiting = waiting_at_[uint32_t(store)];
+	for (uint32_t i = 0; i < waiting.size();) {
+		Order *o = accepted_orders_.get(waiting[i]);
+		if (o == nullptr || o->courier == courier) {
+			if (o) {
+				o->is_delivering = true;
+				record_event(EventType::OrderPickedUp, time_, waiting[i], *o, store);
+				delivering_to_[uint32_t(o->client)].emplace_back(waiting[i]);
+			}
+			//(picked up or expired; either way, no longer waiting here)
+			waiting[i] = waiting.back();
+			waiting.pop_back();
+		} else {
+			i++;
 		}
 	}
-	view->set_accepted_orders(accepted_orders_);
 }
-void OrderController::deliver_order(Location client) {
-	for (auto it = accepted_orders_.begin(); it!=accepted_orders_.end();) {
-		if (it->client==client && it->is_delivering) {
-			add_income(it->income);
-			it = accepted_orders_.erase(it);
+void OrderController::deliver_order(Location client, uint32_t courier) {
+	if (uint32_t(client) >= delivering_to_.size()) return;
+	auto &delivering = delivering_to_[uint32_t(client)];
+	for (uint32_t i = 0; i < delivering.size();) {
+		Order const *o = accepted_orders_.get(delivering[i]);
+		if (o == nullptr || o->courier == courier) {
+			if (o) {
+				add_income(o->income);
+				delivered_orders += 1;
+				record_event(EventType::OrderDelivered, time_, delivering[i], *o, client);
+				accepted_orders_.erase(delivering[i]);
+			}
+			delivering[i] = delivering.back();
+			delivering.pop_back();
 		} else {
-			it++;
+			i++;
 		}
 	}
-	view->set_accepted_orders(accepted_orders_);
+}
+bool OrderController::can_pickup_at(Location store, uint32_t courier) const {
+	if (uint32_t(store) >= waiting_at_.size()) return false;
+	for (OrderId id : waiting_at_[uint32_t(store)]) {
+		Order const *o = accepted_orders_.get(id);
+		if (o && o->courier == courier) return true;
+	}
+	return false;
+}
+bool OrderController::can_deliver_at(Location client, uint32_t courier) const {
+	if (uint32_t(client) >= delivering_to_.size()) return false;
+	for (OrderId id : delivering_to_[uint32_t(client)]) {
+		Order const *o = accepted_orders_.get(id);
+		if (o && o->courier == courier) return true;
+	}
+	return false;
 }
 void OrderController::add_income(int delta) {
 	current_income_ += delta;
-	view->set_total_income(current_income_);
 }
 
 void OrderController::update(float elapsed) {
-	next_order_remaining_time -= elapsed;
+	time_ += elapsed;
 
-	if (next_order_remaining_time <= 0) {
-		generate_new_pending_order();
-	}
+	generate_new_pending_orders();
 //	for (auto it = pending_orders_.begin(); it!=pending_orders_.end();) {
 //		it->remaining_time -= elapsed;
 //		if (it->remaining_time <= 0) {
@@ -74,27 +125,135 @@ void OrderController::update(float elapsed) {
 //			it++;
 //		}
 //	}
-	for (auto it = accepted_orders_.begin(); it!=accepted_orders_.end();) {
-		it->remaining_time -= elapsed;
-		if (it->remaining_time <= 0) {
-			it = accepted_orders_.erase(it);
-		} else {
-			it++;
+	//expire accepted orders whose deadlines have passed:
+	while (!deadlines_.empty() && deadlines_.front().first <= time_) {
+		OrderId id = deadlines_.front().second;
+		std::pop_heap(deadlines_.begin(), deadlines_.end(), later_deadline);
+		deadlines_.pop_back();
+		//(already delivered if the id is stale)
+		if (Order const *o = accepted_orders_.get(id)) {
+			record_event(EventType::OrderExpired, time_, id, *o, o->is_delivering ? o->client : o->store);
+			accepted_orders_.erase(id);
+			expired_orders += 1;
+		}
+	}
+}
+void OrderController::generate_new_pending_orders() {
+	//(the demand clock starts when the controller is seeded, the trace clock when replay starts)
+	arrivals_.clear();
+	if (replay_) replay_->read(time_ - demand_start_, &arrivals_);
+	else demand_.generate(time_ - demand_start_, &arrivals_);
+	uint32_t max_pending = demand_.get_model().max_pending;
+	for (auto &arrival : arrivals_) {
+		arrival.time += demand_start_;
+		if (max_pending != 0 && pending_orders_.size() >= max_pending) continue; //(no room; customer goes elsewhere)
+		OrderId id = pending_orders_.insert(arrival.order);
+		pending_since_.emplace_back(arrival.time, id);
+		record_event(EventType::OrderCreated, arrival.time, id, arrival.order, arrival.order.store);
+		if (record_) {
+			record_->write(DemandGenerator::Arrival{arrival.time - record_start_, arrival.order});
+		}
+	}
+
+	//cancel orders that have been pending too long:
+	float patience = demand_.get_model().patience;
+	if (patience <= 0.0f) {
+		pending_since_.clear();
+		return;
+	}
+	while (!pending_since_.empty() && pending_since_.front().first + patience <= time_) {
+		OrderId id = pending_since_.front().second;
+		if (Order const *o = pending_orders_.get(id)) {
+			record_event(EventType::OrderCancelled, time_, id, *o, o->store);
+			pending_orders_.erase(id);
+			cancelled_orders += 1;
 		}
+		pending_since_.pop_front();
+	}
+}
+void OrderController::record_event(EventType type, double time, OrderId id, Order const &order, Location at) {
+	if (!recorder) return;
+	recorder->record(EventRecord{time, type, order.courier, id, get_location_position(at), uint32_t(at)});
+}
+
+struct OrderControllerState {
+	double time;
+	double demand_start;
+	int32_t income;
+	uint32_t delivered_orders, expired_orders, cancelled_orders;
+	uint32_t location_count;
+	uint32_t padding;
+};
+
+//saved form of the (time, order) pairs in deadlines_ and pending_since_ (no padding):
+struct TimedOrderRecord {
+	double time;
+	uint32_t slot;
+	uint32_t generation;
+};
+static_assert(sizeof(TimedOrderRecord) == 8 + 4 + 4, "TimedOrderRecord is packed.");
+static_assert(std::is_trivially_copyable< TimedOrderRecord >::value, "TimedOrderRecords are saved as raw bytes.");
+
+template< typename Container >
+static std::vector< TimedOrderRecord > to_records(Container const &pairs) {
+	std::vector< TimedOrderRecord > records;
+	records.reserve(pairs.size());
+	for (auto const &p : pairs) {
+		records.emplace_back(TimedOrderRecord{p.first, p.second.slot, p.second.generation});
+	}
+	return records;
+}
+
+static std::vector< std::pair< double, OrderId > > from_records(std::vector< TimedOrderRecord > const &records) {
+	std::vector< std::pair< double, OrderId > > pairs;
+	pairs.reserve(records.size());
+	for (TimedOrderRecord const &r : records) {
+		pairs.emplace_back(r.time, OrderId{r.slot, r.generation});
+	}
+	return pairs;
+}
+
+void OrderController::save(std::ostream *to) const {
+	if (replay_) throw std::runtime_error("Can't save order state while replaying a trace.");
+	write_chunk_value("ocs0", OrderControllerState{
+		time_, demand_start_, int32_t(current_income_),
+		delivered_orders, expired_orders, cancelled_orders,
+		get_location_count(), 0
+	}, to);
+	pending_orders_.save(to);
+	accepted_orders_.save(to);
+	write_chunk("ocd1", to_records(deadlines_), to);
+	write_nested_chunks("ocw0", "ocw1", waiting_at_, to);
+	write_nested_chunks("ocv0", "ocv1", delivering_to_, to);
+	write_chunk("ocp1", to_records(pending_since_), to);
+	demand_.save(to);
+}
+
+void OrderController::load(std::istream &from) {
+	OrderControllerState state = read_chunk_value< OrderControllerState >(from, "ocs0");
+	if (state.location_count != get_location_count()) {
+		throw std::runtime_error("Saved orders use " + std::to_string(state.location_count) + " locations, but " + std::to_string(get_location_count()) + " are loaded.");
 	}
-	view->set_pending_orders(pending_orders_);
-	view->set_accepted_orders(accepted_orders_);
-}
-void OrderController::generate_new_pending_order() {
-	using Random = effolkronium::random_static;
-	if (pending_orders_.size() <= 4) {
-		Location client = get_random_client();
-		Location store = get_random_store();
-		int income = Random::get(10, 50);
-		float time = Random::get<float>(30.0f, 90.0f);
-		Order o1{store, client, false, false, income, time};
-		pending_orders_.push_back(o1);
+	pending_orders_.load(from);
+	accepted_orders_.load(from);
+	std::vector< TimedOrderRecord > deadlines, pending_since;
+	read_chunk(from, "ocd1", &deadlines);
+	read_nested_chunks(from, "ocw0", "ocw1", &waiting_at_);
+	read_nested_chunks(from, "ocv0", "ocv1", &delivering_to_);
+	read_chunk(from, "ocp1", &pending_since);
+	deadlines_ = from_records(deadlines);
+	std::vector< std::pair< double, OrderId > > pending = from_records(pending_since);
+	pending_since_.assign(pending.begin(), pending.end());
+	demand_.load(from);
+	if (waiting_at_.size() > get_location_count() || delivering_to_.size() > get_location_count()) {
+		throw std::runtime_error("Saved orders have lists for unknown locations.");
 	}
-	float next_order_arrival = Random::get<float>(5.0f, 15.0f);
-	next_order_remaining_time = next_order_arrival;
+
+	time_ = state.time;
+	demand_start_ = state.demand_start;
+	current_income_ = state.income;
+	delivered_orders = state.delivered_orders;
+	expired_orders = state.expired_orders;
+	cancelled_orders = state.cancelled_orders;
+	replay_.reset();
 }
@@ -1,24 +1,84 @@
 #pragma once
 
 #include "OrderModels.hpp"
-#include "OrderViews.hpp"
+#include "OrderPool.hpp"
+#include "DemandGenerator.hpp"
+#include "OrderTrace.hpp"
+#include "EventRecorder.hpp"
+#include <deque>
+#include <memory>
 #include <vector>
+#include <cstdint>
 
+//OrderController owns the order book (pending + accepted orders) and income.
+// It does not depend on SDL/GL, so it can be driven by PlayMode (which mirrors
+// its state into view::OrderSideBarView) or by a headless Simulation.
 class OrderController {
 public:
-	OrderController();
+	OrderController(); //seeded nondeterministically
+	explicit OrderController(uint32_t seed);
+	//restart the order stream; same seed + same sequence of calls gives the same orders:
+	void seed(uint32_t value);
+	//change arrival rates / location weights / order terms (see DemandGenerator):
+	void set_demand(DemandModel const &model) { demand_.set_model(model); }
+	DemandModel const &get_demand() const { return demand_.get_model(); }
+	//take orders from a trace file (timed from now) instead of the demand model; throws on trace errors:
+	void replay(std::string const &trace_path);
+	//also write every new order to a trace file (from now on):
+	void record(std::string const &trace_path);
+	//write / restore all order state (both pools, deadlines, demand streams, clock, totals) as chunks:
+	// (load into a controller with the same demand model and location catalog; throws on format errors,
+	//  and save throws while replaying a trace)
+	void save(std::ostream *to) const;
+	void load(std::istream &from);
 	void update(float elapsed);
-	bool handle_keypress(SDL_Keycode key);
-	void draw();
+	//move pending order 'id' to the accepted pool; returns false if 'id' is stale:
+	// (the order gets a new id in the accepted pool, stored in 'accepted' if given)
+	bool accept_pending_order(OrderId id, uint32_t courier = 0, OrderId *accepted = nullptr);
 	const Order &get_current_active_order();
-	void pickup_order(Location store);
-	void deliver_order(Location client);
+	//pickup / deliver only affect orders carried by 'courier':
+	// (both cost O(accepted orders at that location))
+	void pickup_order(Location store, uint32_t courier = 0);
+	void deliver_order(Location client, uint32_t courier = 0);
+	//"what can I do here" queries, same cost:
+	bool can_pickup_at(Location store, uint32_t courier = 0) const;
+	bool can_deliver_at(Location client, uint32_t courier = 0) const;
 	void add_income(int delta);
-	std::vector<Order> pending_orders_;
-	std::vector<Order> accepted_orders_;
+	int get_income() const { return current_income_; }
+	//seconds of update() so far (the clock order deadlines are measured on):
+	double get_time() const { return time_; }
+	//seconds left before an accepted order expires:
+	float get_remaining_time(Order const &order) const { return float(order.deadline - time_); }
+	OrderPool pending_orders_;
+	OrderPool accepted_orders_;
+
+	//running totals, useful for reporting simulation results:
+	uint32_t delivered_orders = 0;
+	uint32_t expired_orders = 0;
+	uint32_t cancelled_orders = 0; //pending orders nobody accepted in time
+
+	//(optional) receives an event for every order created / accepted / picked up / delivered / expired / cancelled; not owned:
+	EventRecorder *recorder = nullptr;
 private:
-	void generate_new_pending_order();
+	void generate_new_pending_orders();
+	void record_event(EventType type, double time, OrderId id, Order const &order, Location at);
+	double time_ = 0.0;
+	//min-heap of (deadline, accepted order); entries for orders delivered
+	// before their deadline are left in place and skipped when they surface:
+	std::vector< std::pair< double, OrderId > > deadlines_;
+	//accepted orders by location -- waiting for pickup at each store, and out for delivery
+	// to each client. Expired orders' ids go stale and are dropped on the next scan.
+	// (indexed by Location; grown to the catalog's size as orders are accepted)
+	std::vector< std::vector< OrderId > > waiting_at_;
+	std::vector< std::vector< OrderId > > delivering_to_;
 	int current_income_ = 0;
-	std::shared_ptr<view::OrderSideBarView> view;
-	float next_order_remaining_time = 0.0;
-};
\ No newline at end of file
+	DemandGenerator demand_;
+	double demand_start_ = 0.0; //time_ when demand_ was seeded (or the replay started)
+	std::unique_ptr< OrderTraceReader > replay_; //(if set, orders come from here instead of demand_)
+	std::unique_ptr< OrderTraceWriter > record_;
+	double record_start_ = 0.0; //time_ when recording started
+	std::vector< DemandGenerator::Arrival > arrivals_; //(scratch space for generate_new_pending_orders)
+	//pending orders in arrival order, for cancelling them once the customer runs out of patience:
+	// (ids of accepted orders go stale and are skipped)
+	std::deque< std::pair< double, OrderId > > pending_since_;
+};
@@ -1,49 +1,28 @@
 #include "OrderModels.hpp"
 
-#include <exception>
-#include "random.hpp"
+#include <stdexcept>
 
-glm::u8vec4 get_location_color(Location loc) {
-	switch (loc) {
-		case Location::STORE_CHEESECAKE: return glm::u8vec4(0xEB, 0xE1, 0x60, 0xff);
-		case Location::STORE_PANCAKE: return glm::u8vec4(0xC0, 0xDF, 0xDD, 0xff);
-		case Location::CLIENT1: return glm::u8vec4(0xc4, 0xfa, 0x89, 0xff);
-		case Location::CLIENT2: return glm::u8vec4(0x44, 0xbd, 0xd8, 0xff);
-		case Location::CLIENT3: return glm::u8vec4(0xea, 0xe8, 0x61, 0xff);
-		case Location::CLIENT4: return glm::u8vec4(0xff, 0x91, 0x9a, 0xff);
-		default: throw std::invalid_argument("loc not recognized");
-	}
-}
-std::string get_location_name(Location loc) {
-	switch (loc) {
-		case Location::STORE_CHEESECAKE: return "Cheesecake Workshop";
-		case Location::STORE_PANCAKE: return "Tartan Pancakes";
-		case Location::CLIENT1: return "client1";
-		case Location::CLIENT2: return "client2";
-		case Location::CLIENT3: return "client3";
-		case Location::CLIENT4: return "client4";
-		default: throw std::invalid_argument("loc not recognized");
-	}
+static LocationCatalog const &catalog_for(Location loc) {
+	LocationCatalog const &catalog = get_location_catalog();
+	if (uint32_t(loc) >= catalog.size()) throw std::invalid_argument("loc not recognized");
+	return catalog;
 }
 
-glm::vec3 get_location_position(Location loc) {
-	switch (loc) {
-		case Location::STORE_CHEESECAKE: return glm::vec3(-3.0f, -3.0f, 0.0f);
-		case Location::STORE_PANCAKE: return glm::vec3(17.0f, 0.0f, 0.0f);
-		case Location::CLIENT1: return glm::vec3(-9.0f, 11.0f, 0.0f);
-		case Location::CLIENT2: return glm::vec3(6.0f, 11.0f, 0.0f);
-		case Location::CLIENT3: return glm::vec3(10.0f, -11.0f, 0.0f);
-		case Location::CLIENT4: return glm::vec3(7.0f, 2.0f, 0.0f);
-		default: throw std::invalid_argument("loc not recognized");
-	}
+uint32_t get_location_count() {
+	return get_location_catalog().size();
 }
 
-using Random = effolkronium::random_static;
+glm::u8vec4 get_location_color(Location loc) {
+	return catalog_for(loc).colors[uint32_t(loc)];
+}
 
-Location get_random_store() {
-	return Random::get({Location::STORE_CHEESECAKE, Location::STORE_PANCAKE});
+std::string get_location_name(Location loc) {
+	LocationCatalog const &catalog = catalog_for(loc);
+	uint32_t i = uint32_t(loc);
+	uint32_t begin = (i == 0 ? 0 : catalog.name_ends[i-1]);
+	return std::string(catalog.name_chars.begin() + begin, catalog.name_chars.begin() + catalog.name_ends[i]);
 }
 
-Location get_random_client() {
-	return Random::get({Location::CLIENT1, Location::CLIENT2, Location::CLIENT3, Location::CLIENT4});
+glm::vec3 get_location_position(Location loc) {
+	return catalog_for(loc).positions[uint32_t(loc)];
 }
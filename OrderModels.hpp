@@ -2,8 +2,11 @@
 
 #include <glm/glm.hpp>
 #include <string>
+#include "LocationCatalog.hpp"
 
-enum class Location {
+//locations are indices into the current LocationCatalog;
+// the built-in catalog (used unless the scene file provides one) has these six:
+enum class Location : uint32_t {
     STORE_CHEESECAKE,
     STORE_PANCAKE,
     CLIENT1,
@@ -12,16 +15,15 @@ enum class Location {
     CLIENT4
 };
 
+//number of locations in the current catalog (they are numbered 0 .. get_location_count()-1):
+uint32_t get_location_count();
+
 glm::vec3 get_location_position(Location loc);
 
 glm::u8vec4 get_location_color(Location loc);
 
 std::string get_location_name(Location loc);
 
-Location get_random_store();
-
-Location get_random_client();
-
 struct Order {
     Location store;
     Location client;
@@ -36,5 +38,14 @@ struct Order {
     int income;
 
     // remaining time: the remaing time in seconds (time-in-game)
+    // for accepted orders, this is the time limit as of acceptance; see deadline.
     float remaining_time;
+
+    // courier carrying this order (only valid when is_accepted==true)
+    // the player is courier 0; fleet simulations number couriers from 0 too.
+    uint32_t courier = 0;
+
+    // absolute expiry time (on OrderController's clock), set on acceptance
+    // only valid when is_accepted==true
+    double deadline = 0.0;
 };
\ No newline at end of file
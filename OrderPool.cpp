@@ -0,0 +1,164 @@
+#include "OrderPool.hpp"
+
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+
+OrderId OrderPool::insert(Order const &order) {
+	uint32_t slot;
+	if (free_head_ != -1U) {
+		slot = free_head_;
+		free_head_ = slots_[slot].dense;
+	} else {
+		slot = uint32_t(slots_.size());
+		slots_.emplace_back();
+	}
+	slots_[slot].dense = uint32_t(orders_.size());
+	orders_.emplace_back(order);
+	dense_slot_.emplace_back(slot);
+	dense_sequence_.emplace_back(next_sequence_++);
+	return OrderId{slot, slots_[slot].generation};
+}
+
+bool OrderPool::erase(OrderId id) {
+	if (!contains(id)) return false;
+	erase_at(slots_[id.slot].dense);
+	return true;
+}
+
+void OrderPool::erase_at(uint32_t i) {
+	assert(i < orders_.size());
+	uint32_t slot = dense_slot_[i];
+
+	//move last order into the hole:
+	uint32_t last = uint32_t(orders_.size()) - 1;
+	if (i != last) {
+		orders_[i] = orders_[last];
+		dense_slot_[i] = dense_slot_[last];
+		dense_sequence_[i] = dense_sequence_[last];
+		slots_[dense_slot_[i]].dense = i;
+	}
+	orders_.pop_back();
+	dense_slot_.pop_back();
+	dense_sequence_.pop_back();
+
+	//retire the slot (bumping its generation invalidates outstanding ids):
+	slots_[slot].generation += 1;
+	slots_[slot].dense = free_head_;
+	free_head_ = slot;
+}
+
+void OrderPool::clear() {
+	while (!orders_.empty()) {
+		erase_at(uint32_t(orders_.size()) - 1);
+	}
+}
+
+Order *OrderPool::get(OrderId id) {
+	return const_cast< Order * >(static_cast< OrderPool const * >(this)->get(id));
+}
+
+Order const *OrderPool::get(OrderId id) const {
+	if (id.slot >= slots_.size()) return nullptr;
+	Slot const &slot = slots_[id.slot];
+	if (slot.generation != id.generation) return nullptr;
+	//(free slots have their generation bumped on erase, so a matching generation means live)
+	return &orders_[slot.dense];
+}
+
+void OrderPool::ids_by_age(std::vector< OrderId > *ids) const {
+	assert(ids);
+	std::vector< uint32_t > dense(orders_.size());
+	std::iota(dense.begin(), dense.end(), 0);
+	std::sort(dense.begin(), dense.end(), [this](uint32_t a, uint32_t b){
+		return dense_sequence_[a] < dense_sequence_[b];
+	});
+	ids->clear();
+	ids->reserve(dense.size());
+	for (uint32_t i : dense) {
+		ids->emplace_back(id_at(i));
+	}
+}
+
+void OrderPool::list(std::vector< Order > *orders, std::vector< OrderId > *ids_) const {
+	assert(orders);
+	std::vector< OrderId > local_ids;
+	std::vector< OrderId > &ids = (ids_ ? *ids_ : local_ids);
+	ids_by_age(&ids);
+	orders->clear();
+	orders->reserve(ids.size());
+	for (OrderId id : ids) {
+		orders->emplace_back(*get(id));
+	}
+}
+
+//saved form of an Order -- fixed-size fields and no padding, so equal pools save to equal bytes:
+struct OrderRecord {
+	uint32_t store; //Location
+	uint32_t client; //Location
+	uint32_t flags; //OrderAccepted | OrderDelivering
+	int32_t income;
+	float remaining_time;
+	uint32_t courier;
+	double deadline;
+};
+static_assert(sizeof(OrderRecord) == 6 * 4 + 8, "OrderRecord is packed.");
+static_assert(std::is_trivially_copyable< OrderRecord >::value, "OrderRecords are saved as raw bytes.");
+enum : uint32_t { OrderAccepted = 1, OrderDelivering = 2 };
+
+void OrderPool::save(std::ostream *to) const {
+	struct { uint32_t free_head; uint32_t padding; uint64_t next_sequence; } header{free_head_, 0, next_sequence_};
+	std::vector< OrderRecord > records;
+	records.reserve(orders_.size());
+	for (Order const &o : orders_) {
+		records.emplace_back(OrderRecord{
+			uint32_t(o.store), uint32_t(o.client),
+			(o.is_accepted ? OrderAccepted : 0U) | (o.is_delivering ? OrderDelivering : 0U),
+			int32_t(o.income), o.remaining_time, o.courier, o.deadline
+		});
+	}
+	write_chunk_value("opl0", header, to);
+	write_chunk("ops0", slots_, to);
+	write_chunk("opo1", records, to);
+	write_chunk("opd0", dense_slot_, to);
+	write_chunk("opq0", dense_sequence_, to);
+}
+
+void OrderPool::load(std::istream &from) {
+	struct Header { uint32_t free_head; uint32_t padding; uint64_t next_sequence; };
+	Header header = read_chunk_value< Header >(from, "opl0");
+	std::vector< OrderRecord > records;
+	read_chunk(from, "ops0", &slots_);
+	read_chunk(from, "opo1", &records);
+	read_chunk(from, "opd0", &dense_slot_);
+	read_chunk(from, "opq0", &dense_sequence_);
+	free_head_ = header.free_head;
+	next_sequence_ = header.next_sequence;
+	orders_.clear();
+	orders_.reserve(records.size());
+	for (OrderRecord const &r : records) {
+		Order o;
+		o.store = Location(r.store);
+		o.client = Location(r.client);
+		o.is_accepted = (r.flags & OrderAccepted) != 0;
+		o.is_delivering = (r.flags & OrderDelivering) != 0;
+		o.income = r.income;
+		o.remaining_time = r.remaining_time;
+		o.courier = r.courier;
+		o.deadline = r.deadline;
+		orders_.emplace_back(o);
+	}
+
+	bool ok = (dense_slot_.size() == orders_.size() && dense_sequence_.size() == orders_.size());
+	for (uint32_t i = 0; ok && i < dense_slot_.size(); ++i) {
+		ok = (dense_slot_[i] < slots_.size() && slots_[dense_slot_[i]].dense == i);
+	}
+	if (!ok) {
+		*this = OrderPool();
+		throw std::runtime_error("Saved order pool is inconsistent.");
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+ * OrderPool is a generational slot map of Orders:
+ *  - insert / erase / lookup are O(1) and never shift other orders around
+ *  - an OrderId stays valid until its order is erased; after that, lookups
+ *    with it fail (the slot's generation has moved on) even if the slot is reused
+ *  - orders are stored densely, so iterating over a pool is a linear pass
+ *
+ * Dense order is unspecified (erase moves the last order into the hole);
+ *  use ids_by_age() / list() for a stable, oldest-first ordering.
+ */
+
+#include "OrderModels.hpp"
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+struct OrderId {
+	uint32_t slot = -1U;
+	uint32_t generation = 0;
+	bool operator==(OrderId const &other) const { return slot == other.slot && generation == other.generation; }
+	bool operator!=(OrderId const &other) const { return !(*this == other); }
+};
+
+class OrderPool {
+public:
+	OrderId insert(Order const &order);
+	//returns false if 'id' is stale:
+	bool erase(OrderId id);
+	//erase the order at dense index 'i' (the last order moves to 'i'):
+	void erase_at(uint32_t i);
+	void clear();
+
+	//nullptr if 'id' is stale:
+	Order *get(OrderId id);
+	Order const *get(OrderId id) const;
+	bool contains(OrderId id) const { return get(id) != nullptr; }
+
+	uint32_t size() const { return uint32_t(orders_.size()); }
+	bool empty() const { return orders_.empty(); }
+
+	//dense access:
+	Order &operator[](uint32_t i) { return orders_[i]; }
+	Order const &operator[](uint32_t i) const { return orders_[i]; }
+	OrderId id_at(uint32_t i) const { return OrderId{dense_slot_[i], slots_[dense_slot_[i]].generation}; }
+	std::vector< Order >::iterator begin() { return orders_.begin(); }
+	std::vector< Order >::iterator end() { return orders_.end(); }
+	std::vector< Order >::const_iterator begin() const { return orders_.begin(); }
+	std::vector< Order >::const_iterator end() const { return orders_.end(); }
+
+	//ids of all orders, oldest first:
+	void ids_by_age(std::vector< OrderId > *ids) const;
+	//copies of all orders (and, optionally, their ids), oldest first -- for views that want plain vectors:
+	void list(std::vector< Order > *orders, std::vector< OrderId > *ids = nullptr) const;
+
+	//write / restore the whole pool (ids stay valid across a save + load) as chunks; load throws on format errors:
+	void save(std::ostream *to) const;
+	void load(std::istream &from);
+
+private:
+	struct Slot {
+		uint32_t generation = 0;
+		uint32_t dense = -1U; //index in orders_ when live; next free slot when free
+	};
+	std::vector< Slot > slots_;
+	uint32_t free_head_ = -1U;
+
+	std::vector< Order > orders_;
+	std::vector< uint32_t > dense_slot_; //slot of each order
+	std::vector< uint64_t > dense_sequence_; //insertion count of each order (for oldest-first listing)
+	uint64_t next_sequence_ = 0;
+};
@@ -0,0 +1,87 @@
+#include "OrderTrace.hpp"
+
+#include "read_write_chunk.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+OrderTraceWriter::OrderTraceWriter(std::string const &filename_) : filename(filename_), file(filename_, std::ios::binary) {
+	if (!file) throw std::runtime_error("Failed to open order trace '" + filename + "' for writing.");
+	TraceHeader header;
+	header.location_count = get_location_count();
+	write_chunk("otr0", std::vector< TraceHeader >{header}, &file);
+	buffer.reserve(ChunkRecords);
+}
+
+OrderTraceWriter::~OrderTraceWriter() {
+	try {
+		flush();
+	} catch (std::exception const &e) {
+		std::cerr << "WARNING: " << e.what() << std::endl;
+	}
+}
+
+void OrderTraceWriter::write(DemandGenerator::Arrival const &arrival) {
+	if (arrival.time < last_time) throw std::runtime_error("Order trace '" + filename + "' written out of order.");
+	last_time = arrival.time;
+	buffer.emplace_back(TraceRecord{
+		arrival.time,
+		uint32_t(arrival.order.store),
+		uint32_t(arrival.order.client),
+		int32_t(arrival.order.income),
+		arrival.order.remaining_time
+	});
+	if (buffer.size() >= ChunkRecords) flush();
+}
+
+void OrderTraceWriter::flush() {
+	if (!buffer.empty()) {
+		write_chunk("ord0", buffer, &file);
+		written += buffer.size();
+		buffer.clear();
+	}
+	if (!file.flush()) throw std::runtime_error("Failed to write order trace '" + filename + "'.");
+}
+
+OrderTraceReader::OrderTraceReader(std::string const &filename_) : filename(filename_), file(filename_, std::ios::binary) {
+	if (!file) throw std::runtime_error("Failed to open order trace '" + filename + "'.");
+	std::vector< TraceHeader > headers;
+	read_chunk(file, "otr0", &headers);
+	if (headers.size() != 1) throw std::runtime_error("Order trace '" + filename + "' should have one header.");
+	header = headers[0];
+	if (header.version != 1) throw std::runtime_error("Order trace '" + filename + "' has unknown version " + std::to_string(header.version) + ".");
+	if (header.location_count > get_location_count()) {
+		throw std::runtime_error("Order trace '" + filename + "' uses " + std::to_string(header.location_count) + " locations, but only " + std::to_string(get_location_count()) + " are loaded.");
+	}
+}
+
+bool OrderTraceReader::fill() {
+	while (next >= chunk.size()) {
+		if (file.peek() == EOF) return false;
+		read_chunk(file, "ord0", &chunk);
+		next = 0;
+	}
+	return true;
+}
+
+bool OrderTraceReader::done() {
+	return !fill();
+}
+
+uint32_t OrderTraceReader::read(double until, std::vector< DemandGenerator::Arrival > *arrivals) {
+	uint32_t count = 0;
+	while (fill() && chunk[next].time < until) {
+		TraceRecord const &r = chunk[next];
+		if (r.store >= header.location_count || r.client >= header.location_count) {
+			throw std::runtime_error("Order trace '" + filename + "' has a record with an invalid location.");
+		}
+		if (arrivals) {
+			Order order{Location(r.store), Location(r.client), false, false, int(r.income), r.time_limit};
+			arrivals->emplace_back(DemandGenerator::Arrival{r.time, order});
+		}
+		next += 1;
+		count += 1;
+	}
+	returned += count;
+	return count;
+}
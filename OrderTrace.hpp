@@ -0,0 +1,77 @@
+#pragma once
+
+/*
+ * Order traces are logs of customer orders (arrival time, store, client,
+ *  income, time limit) that OrderController can replay instead of generating
+ *  orders from a DemandModel.
+ *
+ * The file is a sequence of read_write_chunk.hpp chunks:
+ *   otr0 len < TraceHeader > [one header]
+ *   ord0 len < TraceRecord > * [orders in arrival order; repeated as often as needed]
+ *
+ * Records are written and read one chunk at a time, so traces of any length
+ *  replay in bounded memory.
+ */
+
+#include "DemandGenerator.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct TraceRecord {
+	double time; //arrival, in seconds from the start of the trace
+	uint32_t store; //Location
+	uint32_t client; //Location
+	int32_t income;
+	float time_limit; //Order::remaining_time
+};
+static_assert(sizeof(TraceRecord) == 8 + 4 + 4 + 4 + 4, "TraceRecord is packed.");
+
+struct TraceHeader {
+	uint32_t version = 1;
+	uint32_t location_count = 0; //size of the catalog the trace was recorded against
+};
+static_assert(sizeof(TraceHeader) == 4 + 4, "TraceHeader is packed.");
+
+struct OrderTraceWriter {
+	//opens (and truncates) 'filename'; throws on failure:
+	explicit OrderTraceWriter(std::string const &filename);
+	~OrderTraceWriter(); //flushes
+
+	//append an arrival; times must not decrease:
+	void write(DemandGenerator::Arrival const &arrival);
+	//write out buffered records (throws on failure):
+	void flush();
+
+	//records per chunk:
+	static constexpr uint32_t ChunkRecords = 16384;
+
+	std::string filename;
+	uint64_t written = 0;
+private:
+	std::ofstream file;
+	std::vector< TraceRecord > buffer;
+	double last_time = 0.0;
+};
+
+struct OrderTraceReader {
+	//opens 'filename' and reads its header; throws on failure or if the trace needs more locations than the catalog has:
+	explicit OrderTraceReader(std::string const &filename);
+
+	//append every order arriving before 'until', oldest first; returns the number appended:
+	uint32_t read(double until, std::vector< DemandGenerator::Arrival > *arrivals);
+
+	//true once every record has been returned:
+	bool done();
+
+	std::string filename;
+	TraceHeader header;
+	uint64_t returned = 0;
+private:
+	bool fill(); //load the next chunk if the current one is used up; false at end of file
+	std::ifstream file;
+	std::vector< TraceRecord > chunk;
+	uint32_t next = 0; //index into chunk
+};
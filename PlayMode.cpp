@@ -7,10 +7,12 @@
 #include "Load.hpp"
 #include "gl_errors.hpp"
 #include "data_path.hpp"
+#include "read_write_chunk.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include <fstream>
 #include <random>
 
 GLuint delivery_meshes_for_lit_color_texture_program = 0;
@@ -20,8 +22,21 @@ Load< MeshBuffer > delivery_meshes(LoadTagDefault, []() -> MeshBuffer const * {
 	return ret;
 });
 
+//delivery.scene may carry the store/client table in a "loc0" chunk:
+struct DeliveryScene : Scene {
+	DeliveryScene(std::string const &filename, std::function< void(Scene &, uint32_t, std::string const &) > const &on_drawable) {
+		load(filename, on_drawable);
+	}
+	virtual void load_extra(std::istream &from, std::vector< char > const &str0, std::vector< uint32_t > const &) override {
+		if (from.peek() != EOF) {
+			locations.read(from, str0);
+		}
+	}
+	LocationCatalog locations = LocationCatalog::builtin();
+};
+
 Load< Scene > delivery_scene(LoadTagDefault, []() -> Scene const * {
-	return new Scene(data_path("delivery.scene"), [&](Scene &scene, Scene::Transform *transform, std::string const &mesh_name){
+	DeliveryScene *ret = new DeliveryScene(data_path("delivery.scene"), [&](Scene &scene, uint32_t transform, std::string const &mesh_name){
 		Mesh const &mesh = delivery_meshes->lookup(mesh_name);
 
 		scene.drawables.emplace_back(transform);
@@ -35,6 +50,8 @@ Load< Scene > delivery_scene(LoadTagDefault, []() -> Scene const * {
 		drawable.pipeline.count = mesh.count;
 
 	});
+	set_location_catalog(ret->locations);
+	return ret;
 });
 
 WalkMesh const *walkmesh = nullptr;
@@ -46,47 +63,64 @@ Load< WalkMeshes > delivery_walkmeshes(LoadTagDefault, []() -> WalkMeshes const
 });
 
 PlayMode::PlayMode() : scene(*delivery_scene) {
+	//the side bar only has room for a handful of pending orders:
+	{
+		DemandModel demand = order_controller->get_demand();
+		demand.max_pending = 5;
+		order_controller->set_demand(demand);
+	}
+
 	//create a car transform:
-	scene.transforms.emplace_back();
-	car.transform = &scene.transforms.back();
+	car.transform = scene.add_transform();
+
+	//attach the "Player" model (and anything under it) to the car:
+	// (the model moves after the car in scene.transforms, so the car's index changes too)
+	for (uint32_t i = 0; i < scene.transforms.size(); ) {
+		if (scene.transforms[i].name != "Player" || scene.transforms[i].parent == car.transform) {
+			++i;
+			continue;
+		}
+		std::vector< uint32_t > remap;
+		scene.set_parent(i, car.transform, &remap);
+		if (!remap.empty()) {
+			car.transform = remap[car.transform];
+			i = 0; //(indices moved; look again -- already-attached models are skipped)
+		}
+	}
 
 	//create a car camera attached to a child of the car transform:
-	scene.transforms.emplace_back();
-	scene.cameras.emplace_back(&scene.transforms.back());
+	scene.cameras.emplace_back(scene.add_transform(car.transform));
 	car.camera = &scene.cameras.back();
 	car.camera->fovy = glm::radians(60.0f);
 	car.camera->near = 0.01f;
-	car.camera->transform->parent = car.transform;
 
 	//car's eyes are 1.8 units above the ground:
-	car.camera->transform->position = glm::vec3(0.0f, -3.0f, 1.0f);
+	scene.transforms[car.camera->transform].position = glm::vec3(0.0f, -3.0f, 1.0f);
 
 	//rotate camera facing direction (-z) to car facing direction (+y):
-	car.camera->transform->rotation = glm::angleAxis(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+	scene.transforms[car.camera->transform].rotation = glm::angleAxis(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
 
 	//start car walking at nearest walk point:
-	car.at = walkmesh->nearest_walk_point(car.transform->position);
+	car.at = walkmesh->nearest_walk_point(scene.transforms[car.transform].position);
 
-	scene.transforms.emplace_back();
-	walker.transform = &scene.transforms.back();
-	scene.transforms.emplace_back();
-	scene.cameras.emplace_back(&scene.transforms.back());
+	walker.transform = scene.add_transform();
+	scene.cameras.emplace_back(scene.add_transform(walker.transform));
 	walker.camera = &scene.cameras.back();
 	walker.camera->fovy = glm::radians(60.0f);
 	walker.camera->near = 0.01f;
-	walker.camera->transform->parent = walker.transform;
-	walker.camera->transform->position = glm::vec3(0.0f, 0.0f, 1.0f);
-	walker.camera->transform->rotation = glm::angleAxis(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-
-	for (auto &transform : scene.transforms) {
-		if (transform.name == "Player"){
-			transform.parent = car.transform;
-		}
-	}
+	scene.transforms[walker.camera->transform].position = glm::vec3(0.0f, 0.0f, 1.0f);
+	scene.transforms[walker.camera->transform].rotation = glm::angleAxis(glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
 
 	button_hint = std::make_shared<view::TextSpan>();
 	button_hint->set_text("").set_position(550, 650).set_visibility(true);
 
+	//pickup / delivery zones:
+	for (uint32_t l = 0; l < get_location_count(); ++l) {
+		triggers.add_zone(get_location_position(Location(l)), order_dis, l);
+	}
+	player_agent = triggers.add_agent();
+	triggers.move_agent(player_agent, scene.transforms[car.transform].position);
+
 }
 
 PlayMode::~PlayMode() {
@@ -114,12 +148,32 @@ bool PlayMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 			down.downs += 1;
 			down.pressed = true;
 			return true;
+		} else if (evt.key.keysym.sym == SDLK_RETURN) {
+			std::pair<int, int> focus = order_view->get_focus();
+			if (focus.first == 0
+			    && focus.second >= 0 && focus.second < (int) pending_view_ids.size()
+			    && order_controller->accept_pending_order(pending_view_ids[focus.second])) {
+				refresh_order_view();
+				return true;
+			}
+			return false;
+		} else if (evt.key.keysym.sym == SDLK_F5) {
+			save_snapshot("quicksave.snapshot");
+			std::cout << "Saved 'quicksave.snapshot'." << std::endl;
+			return true;
+		} else if (evt.key.keysym.sym == SDLK_F9) {
+			try {
+				load_snapshot("quicksave.snapshot");
+				std::cout << "Loaded 'quicksave.snapshot'." << std::endl;
+			} catch (std::exception const &e) {
+				std::cerr << "WARNING: failed to load 'quicksave.snapshot': " << e.what() << std::endl;
+			}
+			return true;
 		} else if (
 			evt.key.keysym.sym == SDLK_UP
 			|| evt.key.keysym.sym == SDLK_DOWN
-			|| evt.key.keysym.sym == SDLK_RETURN
 			) {
-			return order_controller->handle_keypress(evt.key.keysym.sym);
+			return order_view->handle_keypress(evt.key.keysym.sym);
 		}
 	} else if (evt.type == SDL_KEYUP) {
 		if (evt.key.keysym.sym == SDLK_a) {
@@ -152,14 +206,16 @@ bool PlayMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 				-evt.motion.yrel / float(window_size.y)
 			);
 			glm::vec3 up = walkmesh->to_world_smooth_normal(walker.at);
-			walker.transform->rotation = glm::angleAxis(-motion.x * walker.camera->fovy, up) * walker.transform->rotation;
+			Scene::Transform &walker_transform = scene.transforms[walker.transform];
+			Scene::Transform &camera_transform = scene.transforms[walker.camera->transform];
+			walker_transform.rotation = glm::angleAxis(-motion.x * walker.camera->fovy, up) * walker_transform.rotation;
 
-			float pitch = glm::pitch(walker.camera->transform->rotation);
+			float pitch = glm::pitch(camera_transform.rotation);
 			pitch += motion.y * walker.camera->fovy;
 			//camera looks down -z (basically at the walker's feet) when pitch is at zero.
 			pitch = std::min(pitch, 0.95f * 3.1415926f);
 			pitch = std::max(pitch, 0.05f * 3.1415926f);
-			walker.camera->transform->rotation = glm::angleAxis(pitch, glm::vec3(1.0f, 0.0f, 0.0f));
+			camera_transform.rotation = glm::angleAxis(pitch, glm::vec3(1.0f, 0.0f, 0.0f));
 
 			return true;
 		}
@@ -171,35 +227,89 @@ bool PlayMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 void PlayMode::update_order(){
 	glm::vec3 playerLocation;
 	if (driving)
-		playerLocation = car.transform->position;
+		playerLocation = scene.transforms[car.transform].position;
 	else
-		playerLocation = walker.transform->position;
-	std::vector<Order> acceptedOrders = order_controller->accepted_orders_;
-	for (Order o : acceptedOrders){
-		if (o.is_delivering){
-			if (glm::distance(playerLocation, get_location_position(o.client)) < order_dis){
-				order_controller->deliver_order(o.client);
-			}
-		} else {
-			if (glm::distance(playerLocation, get_location_position(o.store)) < order_dis){
-				order_controller->pickup_order(o.store);
-			}
-		}
+		playerLocation = scene.transforms[walker.transform].position;
+	triggers.move_agent(player_agent, playerLocation);
+	//deliver first, so an order picked up by this press isn't also delivered by it:
+	for (uint32_t zone : triggers.zones_of(player_agent)) {
+		order_controller->deliver_order(Location(triggers.zones[zone].tag));
+	}
+	for (uint32_t zone : triggers.zones_of(player_agent)) {
+		order_controller->pickup_order(Location(triggers.zones[zone].tag));
 	}
 }
 
 void PlayMode::switch_camera(){
 	if (driving){
-		walker.transform->position = car.transform->position;
+		scene.transforms[walker.transform].position = scene.transforms[car.transform].position;
 		walkmesh = &(delivery_walkmeshes->lookup("WalkMesh"));
-		walker.at = walkmesh->nearest_walk_point(walker.transform->position);
+		walker.at = walkmesh->nearest_walk_point(scene.transforms[walker.transform].position);
 	} else {
-		if (glm::distance(walker.transform->position, car.transform->position) > enter_dis)
+		if (glm::distance(scene.transforms[walker.transform].position, scene.transforms[car.transform].position) > enter_dis)
 			return;
 		walkmesh = &(delivery_walkmeshes->lookup("ZMesh"));
 	}
 	button_hint->set_text("");
 	driving = !driving;
+	if (EventRecorder *recorder = order_controller->recorder) {
+		glm::vec3 position = scene.transforms[(driving ? car : walker).transform].position;
+		recorder->record(EventRecord{order_controller->get_time(), EventType::ModeSwitched, 0, OrderId(), position, driving ? 1U : 0U});
+	}
+}
+
+struct PlayerState {
+	uint32_t driving;
+	float car_speed;
+	WalkPoint walker_at;
+	WalkPoint car_at;
+};
+
+struct TransformState {
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+
+void PlayMode::save_snapshot(std::string const &filename) const {
+	std::ofstream file(filename, std::ios::binary);
+	write_chunk_value("pms0", PlayerState{driving ? 1U : 0U, car_speed, walker.at, car.at}, &file);
+	std::vector< TransformState > transforms;
+	transforms.reserve(scene.transforms.size());
+	for (auto const &transform : scene.transforms) {
+		transforms.emplace_back(TransformState{transform.position, transform.rotation, transform.scale});
+	}
+	write_chunk("pmx0", transforms, &file);
+	order_controller->save(&file);
+	if (!file) throw std::runtime_error("Failed to write snapshot '" + filename + "'.");
+}
+
+void PlayMode::load_snapshot(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open snapshot '" + filename + "'.");
+	PlayerState player = read_chunk_value< PlayerState >(file, "pms0");
+	std::vector< TransformState > transforms;
+	read_chunk(file, "pmx0", &transforms);
+	if (transforms.size() != scene.transforms.size()) {
+		throw std::runtime_error("Snapshot is from a different scene.");
+	}
+	//(player and scene are only changed once everything has been read)
+	order_controller->load(file);
+
+	auto state = transforms.begin();
+	for (auto &transform : scene.transforms) {
+		transform.position = state->position;
+		transform.rotation = state->rotation;
+		transform.scale = state->scale;
+		++state;
+	}
+	driving = (player.driving != 0);
+	car_speed = player.car_speed;
+	walker.at = player.walker_at;
+	car.at = player.car_at;
+	walkmesh = &(delivery_walkmeshes->lookup(driving ? "ZMesh" : "WalkMesh"));
+	triggers.move_agent(player_agent, scene.transforms[(driving ? car : walker).transform].position);
+	refresh_order_view();
 }
 
 glm::vec2 PlayMode::update_walker(float elapsed){
@@ -214,26 +324,17 @@ glm::vec2 PlayMode::update_walker(float elapsed){
 	//make it so that moving diagonally doesn't go faster:
 	if (move != glm::vec2(0.0f)) move = glm::normalize(move) * PlayerSpeed * elapsed;
 	button_hint->set_text("");
-	if (glm::distance(walker.transform->position, car.transform->position) <= enter_dis){
+	if (glm::distance(scene.transforms[walker.transform].position, scene.transforms[car.transform].position) <= enter_dis){
 		button_hint->set_text("Press F to enter car.");
 	}
 
-	glm::vec3 playerLocation;
-	if (driving)
-		playerLocation = car.transform->position;
-	else
-		playerLocation = walker.transform->position;
-	std::vector<Order> acceptedOrders = order_controller->accepted_orders_;
-	
-	for (Order o : acceptedOrders){
-		if (o.is_delivering){
-			if (glm::distance(playerLocation, get_location_position(o.client)) < order_dis){
-				button_hint->set_text("Press E to deliver order(s).");
-			}
-		} else {
-			if (glm::distance(playerLocation, get_location_position(o.store)) < order_dis){
-				button_hint->set_text("Press E to pickup order(s).");
-			}
+	//(zones as of the end of the last update)
+	for (uint32_t zone : triggers.zones_of(player_agent)) {
+		Location l = Location(triggers.zones[zone].tag);
+		if (order_controller->can_deliver_at(l)) {
+			button_hint->set_text("Press E to deliver order(s).");
+		} else if (order_controller->can_pickup_at(l)) {
+			button_hint->set_text("Press E to pickup order(s).");
 		}
 	}
 
@@ -255,7 +356,8 @@ glm::vec2 PlayMode::update_car(float elapsed){
 		glm::vec3 normal = walkmesh->to_world_smooth_normal(car.at);
 		if (move.y != 0){
 			move.x = abs(move.y)*glm::tan(glm::radians(turn_speed*move.x*elapsed));
-			car.transform->rotation = glm::angleAxis(glm::atan(move.x/move.y), normal) * car.transform->rotation;
+			Scene::Transform &car_transform = scene.transforms[car.transform];
+			car_transform.rotation = glm::angleAxis(glm::atan(move.x/move.y), normal) * car_transform.rotation;
 		}else
 			move.x = 0.0f;
 	
@@ -283,66 +385,31 @@ void PlayMode::update(float elapsed) {
 		target = &walker;
 	}
 	
+	Scene::Transform &target_transform = scene.transforms[target->transform];
+
 	//get move in world coordinate system:
-	glm::vec3 remain = target->transform->make_local_to_world() * glm::vec4(move.x, move.y, 0.0f, 0.0f);
-	//using a for() instead of a while() here so that if walkpoint gets stuck in
-	// some awkward case, code will not infinite loop:
-	for (uint32_t iter = 0; iter < 10; ++iter) {
-		if (remain == glm::vec3(0.0f)) break;
-		WalkPoint end;
-		float time;
-		walkmesh->walk_in_triangle(target->at, remain, &end, &time);
-		target->at = end;
-		if (time == 1.0f) {
-			//finished within triangle:
-			remain = glm::vec3(0.0f);
-			break;
-		}
-		//some step remains:
-		remain *= (1.0f - time);
-		//try to step over edge:
-		glm::quat rotation;
-		if (walkmesh->cross_edge(target->at, &end, &rotation)) {
-			//stepped to a new triangle:
-			target->at = end;
-			//rotate step to follow surface:
-			remain = rotation * remain;
-		} else {
-			//ran into a wall, bounce / slide along it:
-			glm::vec3 const &a = walkmesh->vertices[target->at.indices.x];
-			glm::vec3 const &b = walkmesh->vertices[target->at.indices.y];
-			glm::vec3 const &c = walkmesh->vertices[target->at.indices.z];
-			glm::vec3 along = glm::normalize(b-a);
-			glm::vec3 normal = glm::normalize(glm::cross(b-a, c-a));
-			glm::vec3 in = glm::cross(normal, along);
-
-			//check how much 'remain' is pointing out of the triangle:
-			float d = glm::dot(remain, in);
-			if (d < 0.0f) {
-				//bounce off of the wall:
-				remain += (-1.25f * d) * in;
-			} else {
-				//if it's just pointing along the edge, bend slightly away from wall:
-				remain += 0.01f * d * in;
-			}
-		}
-	}
+	glm::vec3 remain = scene.make_local_to_world(target->transform) * glm::vec4(move.x, move.y, 0.0f, 0.0f);
+	remain = walkmesh->walk(&target->at, remain);
 
 	if (remain != glm::vec3(0.0f)) {
 		std::cout << "NOTE: code used full iteration budget for walking." << std::endl;
 	}
 
 	//update car's position to respect walking:
-	target->transform->position = walkmesh->to_world_point(target->at);
+	target_transform.position = walkmesh->to_world_point(target->at);
+	triggers.move_agent(player_agent, target_transform.position);
+	if (EventRecorder *recorder = order_controller->recorder) {
+		recorder->record(EventRecord{order_controller->get_time(), EventType::CourierMoved, 0, OrderId(), target_transform.position, 0});
+	}
 
 	{ //update car's rotation to respect local (smooth) up-vector:
 		
 		glm::quat adjust = glm::rotation(
-			target->transform->rotation * glm::vec3(0.0f, 0.0f, 1.0f), //current up vector
+			target_transform.rotation * glm::vec3(0.0f, 0.0f, 1.0f), //current up vector
 			// current_norm,
 			walkmesh->to_world_smooth_normal(target->at) //smoothed up vector at walk location
 		);
-		target->transform->rotation = glm::normalize(adjust * target->transform->rotation);
+		target_transform.rotation = glm::normalize(adjust * target_transform.rotation);
 	
 	}
 	//reset button press counters:
@@ -379,6 +446,19 @@ void PlayMode::draw(glm::uvec2 const &drawable_size) {
 	}
 	
 	button_hint->draw();
-	order_controller->draw();
+	//refresh side bar here (not in update) so view cost doesn't scale with simulation steps:
+	refresh_order_view();
+	order_view->draw();
 	GL_ERRORS();
 }
+
+void PlayMode::refresh_order_view() {
+	order_controller->pending_orders_.list(&pending_view, &pending_view_ids);
+	order_controller->accepted_orders_.list(&accepted_view);
+	for (Order &o : accepted_view) {
+		o.remaining_time = order_controller->get_remaining_time(o);
+	}
+	order_view->set_pending_orders(pending_view);
+	order_view->set_accepted_orders(accepted_view);
+	order_view->set_total_income(order_controller->get_income());
+}
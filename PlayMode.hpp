@@ -3,6 +3,8 @@
 #include "Scene.hpp"
 #include "WalkMesh.hpp"
 #include "OrderController.hpp"
+#include "OrderViews.hpp"
+#include "TriggerSystem.hpp"
 
 #include <glm/glm.hpp>
 
@@ -18,6 +20,10 @@ struct PlayMode : Mode {
 	virtual void update(float elapsed) override;
 	virtual void draw(glm::uvec2 const &drawable_size) override;
 	void switch_camera();
+	//write / restore player, scene transforms, and order state (F5 / F9 use "quicksave.snapshot"):
+	// (load throws on format errors or if the snapshot is from a different scene)
+	void save_snapshot(std::string const &filename) const;
+	void load_snapshot(std::string const &filename);
 	void update_order();
 	glm::vec2 update_walker(float elapsed);
 	glm::vec2 update_car(float elapsed);
@@ -45,7 +51,7 @@ struct PlayMode : Mode {
 	struct Player {
 		WalkPoint at;
 		//transform is at player's feet and will be yawed by mouse left/right motion:
-		Scene::Transform *transform = nullptr;
+		uint32_t transform = -1U; //(index into scene.transforms)
 		//camera is at player's head and will be pitched by mouse up/down motion:
 		Scene::Camera *camera = nullptr;
 	} walker, car;
@@ -53,5 +59,15 @@ struct PlayMode : Mode {
 	bool driving = true;
 	float car_speed = 0.0f;
 
+	//zones within order_dis of each Location (zone i is Location i), and the player as an agent:
+	TriggerSystem triggers;
+	uint32_t player_agent = 0;
+
 	std::shared_ptr<OrderController> order_controller = std::make_shared<OrderController>();
+	//side bar mirroring order_controller's state (refreshed every draw):
+	std::shared_ptr<view::OrderSideBarView> order_view = std::make_shared<view::OrderSideBarView>();
+	//orders as last shown in the side bar (oldest first), so focus indices map back to order ids:
+	void refresh_order_view();
+	std::vector<Order> pending_view, accepted_view;
+	std::vector<OrderId> pending_view_ids;
 };
@@ -0,0 +1,198 @@
+#include "Router.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+Router::Router(WalkMesh const &walkmesh_) : walkmesh(walkmesh_) {
+	centroids.reserve(walkmesh.triangles.size());
+	for (auto const &tri : walkmesh.triangles) {
+		centroids.emplace_back((walkmesh.vertices[tri.x] + walkmesh.vertices[tri.y] + walkmesh.vertices[tri.z]) / 3.0f);
+	}
+}
+
+bool Router::route(WalkPoint const &from, glm::vec3 const &to, Route *route, Search *search) const {
+	return this->route(from, walkmesh.nearest_walk_point(to), route, search);
+}
+
+//twice the signed area of (a,b,c) in the xy plane; positive when c is left of a->b:
+static float cross2(glm::vec3 const &a, glm::vec3 const &b, glm::vec3 const &c) {
+	return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+static bool same_xy(glm::vec3 const &a, glm::vec3 const &b) {
+	glm::vec2 d = glm::vec2(a) - glm::vec2(b);
+	return glm::dot(d, d) < 1e-12f;
+}
+
+bool Router::route(WalkPoint const &from, WalkPoint const &to, Route *route_, Search *search_) const {
+	assert(route_);
+	auto &route = *route_;
+	route.points.clear();
+	route.length = 0.0f;
+
+	thread_local Search local_search;
+	Search &search = (search_ ? *search_ : local_search);
+
+	uint32_t const triangle_count = uint32_t(walkmesh.triangles.size());
+	assert(from.triangle < triangle_count);
+	assert(to.triangle < triangle_count);
+
+	//(re)size scratch space; stamps avoid clearing it between searches:
+	if (search.stamp.size() != triangle_count) {
+		search.stamp.assign(triangle_count, 0);
+		search.cost.resize(triangle_count);
+		search.came_from.resize(triangle_count);
+		search.generation = 0;
+	}
+	search.generation += 1;
+	if (search.generation == 0) { //wrapped around; clear stamps
+		std::fill(search.stamp.begin(), search.stamp.end(), 0);
+		search.generation = 1;
+	}
+	uint32_t const generation = search.generation;
+
+	glm::vec3 start = walkmesh.to_world_point(from);
+	glm::vec3 goal = walkmesh.to_world_point(to);
+
+	//---- A* over triangles ----
+	auto &open = search.open;
+	open.clear();
+	auto visit = [&](uint32_t ti, float cost, uint32_t came_from) {
+		search.stamp[ti] = generation;
+		search.cost[ti] = cost;
+		search.came_from[ti] = came_from;
+		float estimate = cost + glm::distance(centroids[ti], goal);
+		open.emplace_back(-estimate, ti);
+		std::push_heap(open.begin(), open.end());
+	};
+	visit(from.triangle, glm::distance(start, centroids[from.triangle]), -1U);
+
+	bool found = false;
+	while (!open.empty()) {
+		std::pop_heap(open.begin(), open.end());
+		auto [neg_estimate, ti] = open.back();
+		open.pop_back();
+		if (ti == to.triangle) {
+			found = true;
+			break;
+		}
+		//skip stale heap entries:
+		if (-neg_estimate > search.cost[ti] + glm::distance(centroids[ti], goal) + 1e-4f) continue;
+
+		for (uint32_t k = 0; k < 3; ++k) {
+			uint32_t across = walkmesh.edge_across[3*ti+k];
+			if (across == -1U) continue;
+			uint32_t tj = across / 3;
+			float cost = search.cost[ti] + glm::distance(centroids[ti], centroids[tj]);
+			if (search.stamp[tj] != generation || cost < search.cost[tj]) {
+				visit(tj, cost, 3*ti+k);
+			}
+		}
+	}
+	if (!found) return false;
+
+	//---- corridor + portals ----
+	auto &corridor = search.corridor;
+	auto &portals = search.portals;
+	corridor.clear();
+	portals.clear();
+	portals.emplace_back(start, start);
+	{
+		//walk back from the goal, collecting portals (in reverse):
+		uint32_t ti = to.triangle;
+		while (search.came_from[ti] != -1U) {
+			uint32_t edge = search.came_from[ti];
+			uint32_t prev = edge / 3;
+			uint32_t k = edge % 3;
+			glm::uvec3 const &tri = walkmesh.triangles[prev];
+			//leaving a CCW triangle through [tri[k], tri[k+1]], tri[k+1] is on the left:
+			portals.emplace_back(walkmesh.vertices[tri[(k+1)%3]], walkmesh.vertices[tri[k]]);
+			corridor.emplace_back(ti);
+			ti = prev;
+		}
+		corridor.emplace_back(ti);
+		std::reverse(corridor.begin(), corridor.end());
+		std::reverse(portals.begin() + 1, portals.end());
+	}
+	portals.emplace_back(goal, goal);
+
+	//---- funnel ----
+	route.points.emplace_back(start);
+	glm::vec3 apex = start;
+	glm::vec3 left = start;
+	glm::vec3 right = start;
+	uint32_t apex_index = 0, left_index = 0, right_index = 0;
+	for (uint32_t i = 1; i < portals.size(); ++i) {
+		glm::vec3 const &new_left = portals[i].first;
+		glm::vec3 const &new_right = portals[i].second;
+
+		//try to narrow the funnel from the right:
+		if (cross2(apex, right, new_right) >= 0.0f) {
+			if (same_xy(apex, right) || cross2(apex, left, new_right) < 0.0f) {
+				right = new_right;
+				right_index = i;
+			} else {
+				//right crossed over left; left becomes a corner:
+				route.points.emplace_back(left);
+				apex = left;
+				apex_index = left_index;
+				right = apex;
+				right_index = apex_index;
+				i = apex_index;
+				continue;
+			}
+		}
+
+		//try to narrow the funnel from the left:
+		if (cross2(apex, left, new_left) <= 0.0f) {
+			if (same_xy(apex, left) || cross2(apex, right, new_left) > 0.0f) {
+				left = new_left;
+				left_index = i;
+			} else {
+				//left crossed over right; right becomes a corner:
+				route.points.emplace_back(right);
+				apex = right;
+				apex_index = right_index;
+				left = apex;
+				left_index = apex_index;
+				i = apex_index;
+				continue;
+			}
+		}
+	}
+	if (!same_xy(route.points.back(), goal) || route.points.size() == 1) {
+		route.points.emplace_back(goal);
+	}
+
+	//(the funnel can emit the same corner twice; drop repeats so every corner gets its nudge)
+	route.points.erase(std::unique(route.points.begin(), route.points.end(), [](glm::vec3 const &a, glm::vec3 const &b){
+		return same_xy(a, b);
+	}), route.points.end());
+
+	//corners sit exactly on walkmesh vertices; nudge them away from the inside of the bend
+	// (where the wall is), so that steering at them doesn't graze the walls that meet there:
+	if (clearance > 0.0f) {
+		for (uint32_t i = 1; i + 1 < route.points.size(); ++i) {
+			glm::vec3 const &p = route.points[i];
+			glm::vec2 to_prev = glm::vec2(route.points[i-1]) - glm::vec2(p);
+			glm::vec2 to_next = glm::vec2(route.points[i+1]) - glm::vec2(p);
+			float prev_len = glm::length(to_prev);
+			float next_len = glm::length(to_next);
+			if (prev_len == 0.0f || next_len == 0.0f) continue;
+			glm::vec2 inside = to_prev / prev_len + to_next / next_len;
+			float inside_len = glm::length(inside);
+			if (inside_len < 1e-6f) continue;
+			float amt = std::min(clearance, 0.5f * std::min(prev_len, next_len));
+			glm::vec3 nudged = p - glm::vec3(inside * (amt / inside_len), 0.0f);
+			//(skip the nudge where it would leave the walkmesh, e.g. at a pinch point)
+			glm::vec3 on_mesh = walkmesh.to_world_point(walkmesh.nearest_walk_point(nudged));
+			if (same_xy(on_mesh, nudged)) route.points[i] = on_mesh;
+		}
+	}
+
+	for (uint32_t i = 1; i < route.points.size(); ++i) {
+		route.length += glm::distance(route.points[i-1], route.points[i]);
+	}
+	return true;
+}
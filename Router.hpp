@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+ * Router finds short paths over a WalkMesh:
+ *  - A* over the triangle adjacency graph (WalkMesh::edge_across) picks a corridor of triangles
+ *  - the "funnel" (string-pulling) pass turns the corridor into a list of corner points
+ *
+ * The funnel runs in the xy plane (walk meshes are height fields), then corners
+ *  keep their 3D positions.
+ *
+ * Search scratch space lives in a Router::Search; route() uses a thread_local one
+ *  by default, so many threads can query the same (const) Router with no allocation
+ *  after the first few calls.
+ */
+
+#include "WalkMesh.hpp"
+#include "OrderModels.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct Route {
+	//start point, corners, end point (all on the walkmesh):
+	std::vector< glm::vec3 > points;
+	float length = 0.0f;
+};
+
+struct Router {
+	Router(WalkMesh const &walkmesh);
+
+	//reusable per-search state:
+	struct Search {
+		//per-triangle, valid when stamp[ti] == generation:
+		std::vector< uint32_t > stamp;
+		std::vector< float > cost; //cost from start to centroid
+		std::vector< uint32_t > came_from; //edge (3*ti+k) of the previous triangle used to get here, -1U for start
+		uint32_t generation = 0;
+		//open list (binary heap of (-estimate, triangle)):
+		std::vector< std::pair< float, uint32_t > > open;
+		//corridor (triangles from start to goal) and its portals:
+		std::vector< uint32_t > corridor;
+		std::vector< std::pair< glm::vec3, glm::vec3 > > portals; //(left, right)
+	};
+
+	//find a route from 'from' to the walk point nearest 'to':
+	// returns false (and leaves *route empty) if 'to' is not reachable from 'from'.
+	bool route(WalkPoint const &from, glm::vec3 const &to, Route *route, Search *search = nullptr) const;
+	bool route(WalkPoint const &from, WalkPoint const &to, Route *route, Search *search = nullptr) const;
+
+	//...or to a Location:
+	bool route(WalkPoint const &from, Location to, Route *route, Search *search = nullptr) const {
+		return this->route(from, get_location_position(to), route, search);
+	}
+
+	//corners are moved this far (in xy) off the walkmesh vertices they bend around:
+	float clearance = 0.05f;
+
+	WalkMesh const &walkmesh;
+	std::vector< glm::vec3 > centroids; //per-triangle, precomputed
+};
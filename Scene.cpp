@@ -1,10 +1,12 @@
 #include "Scene.hpp"
 
+#include "WorldMatrices.hpp"
 #include "gl_errors.hpp"
 #include "read_write_chunk.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <fstream>
 
 //-------------------------
@@ -56,19 +58,139 @@ glm::mat4x3 Scene::Transform::make_parent_to_local() const {
 	);
 }
 
-glm::mat4x3 Scene::Transform::make_local_to_world() const {
-	if (!parent) {
-		return make_local_to_parent();
-	} else {
-		return parent->make_local_to_world() * glm::mat4(make_local_to_parent()); //note: glm::mat4(glm::mat4x3) pads with a (0,0,0,1) row
+uint32_t Scene::add_transform(uint32_t parent) {
+	assert(parent == -1U || parent < transforms.size());
+	transforms.emplace_back();
+	transforms.back().parent = parent;
+	return uint32_t(transforms.size() - 1);
+}
+
+void Scene::set_parent(uint32_t transform, uint32_t parent, std::vector< uint32_t > *remap) {
+	assert(transform < transforms.size());
+	assert(parent == -1U || parent < transforms.size());
+	if (remap) remap->clear();
+
+	if (parent == -1U || parent < transform) {
+		transforms[transform].parent = parent;
+		return;
+	}
+
+	//'transform' and its descendants (which all come after it):
+	std::vector< bool > moving(transforms.size(), false);
+	moving[transform] = true;
+	for (uint32_t i = transform + 1; i < transforms.size(); ++i) {
+		if (transforms[i].parent != -1U && moving[transforms[i].parent]) moving[i] = true;
+	}
+	if (moving[parent]) throw std::runtime_error("Can't make transform '" + transforms[parent].name + "' the parent of its ancestor '" + transforms[transform].name + "'.");
+
+	//new order: everything up to and including 'parent' except the moving subtree, then the subtree, then the rest:
+	// (nothing that stays put has a parent in the subtree, so parents still come before children)
+	std::vector< uint32_t > order;
+	order.reserve(transforms.size());
+	for (uint32_t i = 0; i <= parent; ++i) {
+		if (!moving[i]) order.emplace_back(i);
+	}
+	for (uint32_t i = transform; i < transforms.size(); ++i) {
+		if (moving[i]) order.emplace_back(i);
+	}
+	for (uint32_t i = parent + 1; i < transforms.size(); ++i) {
+		if (!moving[i]) order.emplace_back(i);
+	}
+	assert(order.size() == transforms.size());
+
+	std::vector< uint32_t > new_index(transforms.size());
+	for (uint32_t i = 0; i < order.size(); ++i) {
+		new_index[order[i]] = i;
+	}
+
+	transforms[transform].parent = parent;
+	std::vector< Transform > reordered;
+	reordered.reserve(transforms.size());
+	for (uint32_t old : order) {
+		reordered.emplace_back(std::move(transforms[old]));
+		Transform &t = reordered.back();
+		if (t.parent != -1U) t.parent = new_index[t.parent];
+	}
+	transforms = std::move(reordered);
+
+	for (auto &drawable : drawables) drawable.transform = new_index[drawable.transform];
+	for (auto &camera : cameras) camera.transform = new_index[camera.transform];
+	for (auto &light : lights) light.transform = new_index[light.transform];
+
+	if (remap) *remap = std::move(new_index);
+}
+
+//view of the transforms' fields (and cached world matrices) for the batch kernel:
+static TransformArray transform_array(std::vector< Scene::Transform > const &transforms) {
+	TransformArray array;
+	if (transforms.empty()) return array;
+	Scene::Transform const &first = transforms[0];
+	array.position = &first.position;
+	array.rotation = &first.rotation;
+	array.scale = &first.scale;
+	array.parent = &first.parent;
+	array.local_to_world = &first.world_cache.local_to_world;
+	array.stride = sizeof(Scene::Transform);
+	return array;
+}
+
+bool Scene::mark_world_stale(uint32_t index) const {
+	Transform const &t = transforms[index];
+	if (t.parent != -1U && t.parent >= index) {
+		throw std::runtime_error("transform '" + t.name + "' does not come after its parent");
+	}
+	uint64_t parent_version = (t.parent == -1U ? 0 : transforms[t.parent].world_cache.version);
+
+	Transform::WorldCache &cache = t.world_cache;
+	if (cache.version != 0
+	 && cache.parent == t.parent && cache.parent_version == parent_version
+	 && cache.position == t.position && cache.rotation == t.rotation && cache.scale == t.scale) {
+		return false;
+	}
+
+	cache.position = t.position;
+	cache.rotation = t.rotation;
+	cache.scale = t.scale;
+	cache.parent = t.parent;
+	cache.parent_version = parent_version;
+	cache.have_world_to_local = false;
+	cache.version = next_world_version++;
+	return true;
+}
+
+void Scene::update_world() const {
+	//find what changed; parents come first, so a stale parent's new version is seen by its children:
+	stale_transforms.clear();
+	for (uint32_t i = 0; i < transforms.size(); ++i) {
+		if (mark_world_stale(i)) stale_transforms.emplace_back(i);
+	}
+	//recompute all of those matrices in one batch:
+	compute_world_matrices(transform_array(transforms), stale_transforms.data(), uint32_t(stale_transforms.size()));
+}
+
+glm::mat4x3 const &Scene::make_local_to_world(uint32_t index) const {
+	assert(index < transforms.size());
+	//bring ancestors up to date first:
+	uint32_t parent = transforms[index].parent;
+	if (parent != -1U && parent < index) make_local_to_world(parent);
+	if (mark_world_stale(index)) { //(throws on out-of-order parents)
+		compute_world_matrices(transform_array(transforms), &index, 1);
 	}
+	return transforms[index].world_cache.local_to_world;
 }
-glm::mat4x3 Scene::Transform::make_world_to_local() const {
-	if (!parent) {
-		return make_parent_to_local();
-	} else {
-		return make_parent_to_local() * glm::mat4(parent->make_world_to_local()); //note: glm::mat4(glm::mat4x3) pads with a (0,0,0,1) row
+
+glm::mat4x3 const &Scene::make_world_to_local(uint32_t index) const {
+	make_local_to_world(index);
+	Transform const &t = transforms[index];
+	if (!t.world_cache.have_world_to_local) {
+		if (t.parent == -1U) {
+			t.world_cache.world_to_local = t.make_parent_to_local();
+		} else {
+			t.world_cache.world_to_local = t.make_parent_to_local() * glm::mat4(make_world_to_local(t.parent)); //note: glm::mat4(glm::mat4x3) pads with a (0,0,0,1) row
+		}
+		t.world_cache.have_world_to_local = true;
 	}
+	return t.world_cache.world_to_local;
 }
 
 //-------------------------
@@ -81,83 +203,250 @@ glm::mat4 Scene::Camera::make_projection() const {
 
 
 void Scene::draw(Camera const &camera) const {
-	assert(camera.transform);
-	glm::mat4 world_to_clip = camera.make_projection() * glm::mat4(camera.transform->make_world_to_local());
+	glm::mat4 world_to_clip = camera.make_projection() * glm::mat4(make_world_to_local(camera.transform));
 	glm::mat4x3 world_to_light = glm::mat4x3(1.0f);
 	draw(world_to_clip, world_to_light);
 }
 
+//order drawables so those sharing a program, vertex array, and textures are drawn back-to-back:
+// (program first, since switching programs is the most expensive change;
+//  vertex range last, so that copies of the same mesh end up next to each other and can be instanced)
+static bool state_before(Scene::Drawable::Pipeline const &a, Scene::Drawable::Pipeline const &b) {
+	if (a.program != b.program) return a.program < b.program;
+	if (a.vao != b.vao) return a.vao < b.vao;
+	for (uint32_t i = 0; i < Scene::Drawable::Pipeline::TextureCount; ++i) {
+		if (a.textures[i].texture != b.textures[i].texture) return a.textures[i].texture < b.textures[i].texture;
+		if (a.textures[i].target != b.textures[i].target) return a.textures[i].target < b.textures[i].target;
+	}
+	if (a.type != b.type) return a.type < b.type;
+	if (a.start != b.start) return a.start < b.start;
+	if (a.count != b.count) return a.count < b.count;
+	return false;
+}
+
+//per-instance matrices are streamed through one buffer (viewed as an RGBA32F buffer texture), shared by all scenes:
+// (created on first use, since Scene is also used without a GL context)
+struct InstanceBuffer {
+	GLuint buffer = 0;
+	GLuint texture = 0;
+	GLint max_texels = 0; //GL_MAX_TEXTURE_BUFFER_SIZE
+};
+static InstanceBuffer const &instance_buffer() {
+	static InstanceBuffer ret = [](){
+		InstanceBuffer ib;
+		glGenBuffers(1, &ib.buffer);
+		glGenTextures(1, &ib.texture);
+		glBindBuffer(GL_TEXTURE_BUFFER, ib.buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, ib.texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, ib.buffer);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &ib.max_texels);
+		GL_ERRORS();
+		return ib;
+	}();
+	return ret;
+}
+
 void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_light) const {
+	//world matrices for everything, in one pass:
+	update_world();
 
-	//Iterate through all drawables, sending each one to OpenGL:
-	for (auto const &drawable : drawables) {
-		//Reference to drawable's pipeline for convenience:
-		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
+	//sort drawables by state (ties stay in scene order); last frame's order is usually still sorted:
+	if (draw_order.size() != drawables.size()) {
+		draw_order.resize(drawables.size());
+		for (uint32_t i = 0; i < draw_order.size(); ++i) draw_order[i] = i;
+	}
+	auto before = [this](uint32_t a, uint32_t b) {
+		if (state_before(drawables[a].pipeline, drawables[b].pipeline)) return true;
+		if (state_before(drawables[b].pipeline, drawables[a].pipeline)) return false;
+		return a < b;
+	};
+	if (!std::is_sorted(draw_order.begin(), draw_order.end(), before)) {
+		std::sort(draw_order.begin(), draw_order.end(), before);
+	}
 
+	auto skip = [](Drawable::Pipeline const &pipeline) {
 		//skip any drawables without a shader program set:
-		if (pipeline.program == 0) continue;
+		if (pipeline.program == 0) return true;
 		//skip any drawables that don't reference any vertex array:
-		if (pipeline.vao == 0) continue;
+		if (pipeline.vao == 0) return true;
 		//skip any drawables that don't contain any vertices:
-		if (pipeline.count == 0) continue;
-
-
-		//Set shader program:
-		glUseProgram(pipeline.program);
+		if (pipeline.count == 0) return true;
+		return false;
+	};
 
-		//Set attribute sources:
-		glBindVertexArray(pipeline.vao);
+	//draw_order is split into runs; a run of drawables with identical pipelines can become one instanced draw
+	// if the program reads per-instance matrices and no drawable in the run sets custom uniforms:
+	auto run_end = [this](uint32_t begin) {
+		Drawable::Pipeline const &first = drawables[draw_order[begin]].pipeline;
+		uint32_t end = begin + 1;
+		if (first.INSTANCE_BASE_int != -1U && !first.set_uniforms) {
+			while (end < draw_order.size()) {
+				Drawable::Pipeline const &next = drawables[draw_order[end]].pipeline;
+				if (next.set_uniforms || state_before(first, next)) break; //(sorted, so !(first < next) means equal)
+				++end;
+			}
+		}
+		return end;
+	};
 
-		//Configure program uniforms:
+	//split draw_order into the calls to make, gathering every instanced run's matrices so they can be uploaded at once:
+	// (runs of one drawable are drawn with plain uniforms, as are runs that would overflow the buffer texture)
+	draw_runs.clear();
+	instance_data.clear();
+	GLint max_texels = 0;
+	for (uint32_t begin = 0; begin < draw_order.size(); ) {
+		uint32_t end = run_end(begin);
+		if (skip(drawables[draw_order[begin]].pipeline)) {
+			begin = end;
+			continue;
+		}
+		uint32_t first_instance = uint32_t(instance_data.size() / Drawable::Pipeline::InstanceTexels);
+		bool instanced = false;
+		if (end - begin >= 2) {
+			if (max_texels == 0) max_texels = instance_buffer().max_texels;
+			instanced = (uint64_t(first_instance) + (end - begin)) * Drawable::Pipeline::InstanceTexels <= uint64_t(max_texels);
+		}
+		if (!instanced) {
+			for (uint32_t i = begin; i < end; ++i) {
+				draw_runs.emplace_back(DrawRun{ i, i + 1, -1 });
+			}
+			begin = end;
+			continue;
+		}
 
-		//the object-to-world matrix is used in all three of these uniforms:
-		assert(drawable.transform); //drawables *must* have a transform
-		glm::mat4x3 object_to_world = drawable.transform->make_local_to_world();
+		draw_runs.emplace_back(DrawRun{ begin, end, int32_t(first_instance) });
+		for (uint32_t i = begin; i < end; ++i) {
+			Drawable const &drawable = drawables[draw_order[i]];
+			assert(drawable.transform < transforms.size()); //drawables *must* have a transform
+			glm::mat4x3 const &object_to_world = transforms[drawable.transform].world_cache.local_to_world;
 
-		//OBJECT_TO_CLIP takes vertices from object space to clip space:
-		if (pipeline.OBJECT_TO_CLIP_mat4 != -1U) {
+			//same matrices as the uniforms below (layout described in Scene.hpp):
 			glm::mat4 object_to_clip = world_to_clip * glm::mat4(object_to_world);
-			glUniformMatrix4fv(pipeline.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
+			glm::mat4x3 object_to_light = world_to_light * glm::mat4(object_to_world);
+			glm::mat3 normal_to_light = glm::inverse(glm::transpose(glm::mat3(object_to_light)));
+			for (uint32_t c = 0; c < 4; ++c) instance_data.emplace_back(object_to_clip[c]);
+			for (uint32_t c = 0; c < 4; ++c) instance_data.emplace_back(object_to_light[c], 0.0f);
+			for (uint32_t c = 0; c < 3; ++c) instance_data.emplace_back(normal_to_light[c], 0.0f);
 		}
+		begin = end;
+	}
+
+	//GL state set so far, so that only changes are sent:
+	GLuint current_program = 0;
+	GLuint current_vao = 0;
+	uint32_t current_unit = -1U;
+	Drawable::Pipeline::TextureInfo current_textures[Drawable::Pipeline::TextureCount]; //(texture 0 => nothing bound)
+	GLint current_instance_base = -2; //INSTANCE_BASE of current_program (-2 => not yet set during this draw)
+	auto active_texture = [&current_unit](uint32_t unit) {
+		if (current_unit != unit) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			current_unit = unit;
+		}
+	};
 
-		//the object-to-light matrix is used in the next two uniforms:
-		glm::mat4x3 object_to_light = world_to_light * glm::mat4(object_to_world);
+	if (!instance_data.empty()) {
+		InstanceBuffer const &ib = instance_buffer();
+		glBindBuffer(GL_TEXTURE_BUFFER, ib.buffer);
+		glBufferData(GL_TEXTURE_BUFFER, instance_data.size() * sizeof(glm::vec4), instance_data.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
 
-		//OBJECT_TO_CLIP takes vertices from object space to light space:
-		if (pipeline.OBJECT_TO_LIGHT_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_light));
+		active_texture(Drawable::Pipeline::InstanceTextureUnit);
+		glBindTexture(GL_TEXTURE_BUFFER, ib.texture);
+	}
+
+	//Iterate through all runs of drawables, sending each one to OpenGL:
+	for (DrawRun const &run : draw_runs) {
+		bool is_instanced = (run.instance_base != -1);
+
+		Drawable const &drawable = drawables[draw_order[run.begin]];
+		//Reference to drawable's pipeline for convenience:
+		Scene::Drawable::Pipeline const &pipeline = drawable.pipeline;
+
+		//Set shader program:
+		if (pipeline.program != current_program) {
+			glUseProgram(pipeline.program);
+			current_program = pipeline.program;
+			current_instance_base = -2;
 		}
 
-		//NORMAL_TO_CLIP takes normals from object space to light space:
-		if (pipeline.NORMAL_TO_LIGHT_mat3 != -1U) {
-			glm::mat3 normal_to_light = glm::inverse(glm::transpose(glm::mat3(object_to_light)));
-			glUniformMatrix3fv(pipeline.NORMAL_TO_LIGHT_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_light));
+		//Set attribute sources:
+		if (pipeline.vao != current_vao) {
+			glBindVertexArray(pipeline.vao);
+			current_vao = pipeline.vao;
 		}
 
-		//set any requested custom uniforms:
-		if (pipeline.set_uniforms) pipeline.set_uniforms();
+		//Configure program uniforms:
+		if (pipeline.INSTANCE_BASE_int != -1U && run.instance_base != current_instance_base) {
+			glUniform1i(pipeline.INSTANCE_BASE_int, run.instance_base);
+			current_instance_base = run.instance_base;
+		}
 
-		//set up textures:
-		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, pipeline.textures[i].texture);
+		if (!is_instanced) {
+			//the object-to-world matrix is used in all three of these uniforms:
+			assert(drawable.transform < transforms.size()); //drawables *must* have a transform
+			glm::mat4x3 const &object_to_world = transforms[drawable.transform].world_cache.local_to_world;
+
+			//OBJECT_TO_CLIP takes vertices from object space to clip space:
+			if (pipeline.OBJECT_TO_CLIP_mat4 != -1U) {
+				glm::mat4 object_to_clip = world_to_clip * glm::mat4(object_to_world);
+				glUniformMatrix4fv(pipeline.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(object_to_clip));
 			}
-		}
 
-		//draw the object:
-		glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+			//the object-to-light matrix is used in the next two uniforms:
+			glm::mat4x3 object_to_light = world_to_light * glm::mat4(object_to_world);
+
+			//OBJECT_TO_CLIP takes vertices from object space to light space:
+			if (pipeline.OBJECT_TO_LIGHT_mat4x3 != -1U) {
+				glUniformMatrix4x3fv(pipeline.OBJECT_TO_LIGHT_mat4x3, 1, GL_FALSE, glm::value_ptr(object_to_light));
+			}
+
+			//NORMAL_TO_CLIP takes normals from object space to light space:
+			if (pipeline.NORMAL_TO_LIGHT_mat3 != -1U) {
+				glm::mat3 normal_to_light = glm::inverse(glm::transpose(glm::mat3(object_to_light)));
+				glUniformMatrix3fv(pipeline.NORMAL_TO_LIGHT_mat3, 1, GL_FALSE, glm::value_ptr(normal_to_light));
+			}
+
+			//set any requested custom uniforms:
+			if (pipeline.set_uniforms) pipeline.set_uniforms();
+		}
 
-		//un-bind textures:
+		//set up textures (units this drawable doesn't use are left empty, as if unbound after the previous draw):
 		for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
-			if (pipeline.textures[i].texture != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
-				glBindTexture(pipeline.textures[i].target, 0);
+			Drawable::Pipeline::TextureInfo const &want = pipeline.textures[i];
+			Drawable::Pipeline::TextureInfo &have = current_textures[i];
+			if (want.texture == have.texture && (want.texture == 0 || want.target == have.target)) continue;
+			active_texture(i);
+			if (have.texture != 0 && (want.texture == 0 || want.target != have.target)) {
+				glBindTexture(have.target, 0);
 			}
+			if (want.texture != 0) {
+				glBindTexture(want.target, want.texture);
+			}
+			have = want;
 		}
-		glActiveTexture(GL_TEXTURE0);
 
+		//draw the object(s):
+		if (is_instanced) {
+			glDrawArraysInstanced(pipeline.type, pipeline.start, pipeline.count, run.end - run.begin);
+		} else {
+			glDrawArrays(pipeline.type, pipeline.start, pipeline.count);
+		}
+	}
+
+	//un-bind textures:
+	for (uint32_t i = 0; i < Drawable::Pipeline::TextureCount; ++i) {
+		if (current_textures[i].texture != 0) {
+			active_texture(i);
+			glBindTexture(current_textures[i].target, 0);
+		}
+	}
+	if (!instance_data.empty()) {
+		active_texture(Drawable::Pipeline::InstanceTextureUnit);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
 	}
+	glActiveTexture(GL_TEXTURE0);
 
 	glUseProgram(0);
 	glBindVertexArray(0);
@@ -167,7 +456,7 @@ void Scene::draw(glm::mat4 const &world_to_clip, glm::mat4x3 const &world_to_lig
 
 
 void Scene::load(std::string const &filename,
-	std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
+	std::function< void(Scene &, uint32_t, std::string const &) > const &on_drawable) {
 
 	std::ifstream file(filename, std::ios::binary);
 
@@ -221,18 +510,20 @@ void Scene::load(std::string const &filename,
 	//--------------------------------
 	//Now that file is loaded, create transforms for hierarchy entries:
 
-	std::vector< Transform * > hierarchy_transforms;
+	std::vector< uint32_t > hierarchy_transforms;
 	hierarchy_transforms.reserve(hierarchy.size());
+	transforms.reserve(transforms.size() + hierarchy.size());
 
 	for (auto const &h : hierarchy) {
-		transforms.emplace_back();
-		Transform *t = &transforms.back();
+		uint32_t parent = -1U;
 		if (h.parent != -1U) {
 			if (h.parent >= hierarchy_transforms.size()) {
 				throw std::runtime_error("scene file '" + filename + "' did not contain transforms in topological-sort order.");
 			}
-			t->parent = hierarchy_transforms[h.parent];
+			parent = hierarchy_transforms[h.parent];
 		}
+		uint32_t index = add_transform(parent);
+		Transform *t = &transforms[index];
 
 		if (h.name_begin <= h.name_end && h.name_end <= names.size()) {
 			t->name = std::string(names.begin() + h.name_begin, names.begin() + h.name_end);
@@ -244,7 +535,7 @@ void Scene::load(std::string const &filename,
 		t->rotation = h.rotation;
 		t->scale = h.scale;
 
-		hierarchy_transforms.emplace_back(t);
+		hierarchy_transforms.emplace_back(index);
 	}
 	assert(hierarchy_transforms.size() == hierarchy.size());
 
@@ -314,64 +605,6 @@ void Scene::load(std::string const &filename,
 
 //-------------------------
 
-Scene::Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable) {
+Scene::Scene(std::string const &filename, std::function< void(Scene &, uint32_t, std::string const &) > const &on_drawable) {
 	load(filename, on_drawable);
 }
-
-Scene::Scene(Scene const &other) {
-	set(other);
-}
-
-Scene &Scene::operator=(Scene const &other) {
-	set(other);
-	return *this;
-}
-
-void Scene::set(Scene const &other, std::unordered_map< Transform const *, Transform * > *transform_map_) {
-
-	std::unordered_map< Transform const *, Transform * > t2t_temp;
-	std::unordered_map< Transform const *, Transform * > &transform_to_transform = *(transform_map_ ? transform_map_ : &t2t_temp);
-
-	transform_to_transform.clear();
-
-	//null transform maps to itself:
-	transform_to_transform.insert(std::make_pair(nullptr, nullptr));
-
-	//Copy transforms and store mapping:
-	transforms.clear();
-	for (auto const &t : other.transforms) {
-		transforms.emplace_back();
-		transforms.back().name = t.name;
-		transforms.back().position = t.position;
-		transforms.back().rotation = t.rotation;
-		transforms.back().scale = t.scale;
-		transforms.back().parent = t.parent; //will update later
-
-		//store mapping between transforms old and new:
-		auto ret = transform_to_transform.insert(std::make_pair(&t, &transforms.back()));
-		assert(ret.second);
-	}
-
-	//update transform parents:
-	for (auto &t : transforms) {
-		t.parent = transform_to_transform.at(t.parent);
-	}
-
-	//copy other's drawables, updating transform pointers:
-	drawables = other.drawables;
-	for (auto &d : drawables) {
-		d.transform = transform_to_transform.at(d.transform);
-	}
-
-	//copy other's cameras, updating transform pointers:
-	cameras = other.cameras;
-	for (auto &c : cameras) {
-		c.transform = transform_to_transform.at(c.transform);
-	}
-
-	//copy other's lights, updating transform pointers:
-	lights = other.lights;
-	for (auto &l : lights) {
-		l.transform = transform_to_transform.at(l.transform);
-	}
-}
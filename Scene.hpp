@@ -20,7 +20,6 @@
 #include <functional>
 #include <string>
 #include <vector>
-#include <unordered_map>
 
 struct Scene {
 	struct Transform {
@@ -33,26 +32,36 @@ struct Scene {
 		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f);
 
 		//The transform above may be relative to some parent transform:
-		Transform *parent = nullptr;
+		// (index into Scene::transforms; parents must come before their children)
+		uint32_t parent = -1U;
 
 		//It is often convenient to construct matrices representing this transformation:
 		// ..relative to its parent:
 		glm::mat4x3 make_local_to_parent() const;
 		glm::mat4x3 make_parent_to_local() const;
-		// ..relative to the world:
-		glm::mat4x3 make_local_to_world() const;
-		glm::mat4x3 make_world_to_local() const;
-
-		//since hierarchy is tracked through pointers, copy-constructing a transform  is not advised:
-		Transform(Transform const &) = delete;
-		//if we delete some constructors, we need to let the compiler know that the default constructor is still okay:
-		Transform() = default;
+		// ..relative to the world: see Scene::make_local_to_world / make_world_to_local
+
+		//cached world matrices and the inputs they were computed from:
+		// (maintained by Scene; 'version' changes whenever local_to_world is recomputed,
+		//  and children compare it against the parent version they were computed with)
+		struct WorldCache {
+			uint64_t version = 0; //0 => nothing cached yet
+			glm::vec3 position;
+			glm::quat rotation;
+			glm::vec3 scale;
+			uint32_t parent = -1U;
+			uint64_t parent_version = 0;
+			glm::mat4x3 local_to_world;
+			bool have_world_to_local = false;
+			glm::mat4x3 world_to_local;
+		};
+		mutable WorldCache world_cache;
 	};
 
 	struct Drawable {
 		//a 'Drawable' attaches attribute data to a transform:
-		Drawable(Transform *transform_) : transform(transform_) { assert(transform); }
-		Transform * transform;
+		Drawable(uint32_t transform_) : transform(transform_) { assert(transform != -1U); }
+		uint32_t transform; //index into Scene::transforms
 
 		//Contains all the data needed to run the OpenGL pipeline:
 		struct Pipeline {
@@ -78,13 +87,21 @@ struct Scene {
 				GLuint texture = 0;
 				GLenum target = GL_TEXTURE_2D;
 			} textures[TextureCount];
+
+			//(optional) instancing -- Scene::draw combines drawables with identical pipelines (and no set_uniforms)
+			// into one glDrawArraysInstanced if the program can read the three matrices above per instance:
+			// the program's 'samplerBuffer' must sample texture unit InstanceTextureUnit, where instance i's matrices
+			// start at texel (INSTANCE_BASE + gl_InstanceID) * InstanceTexels:
+			//   OBJECT_TO_CLIP columns (4 texels), OBJECT_TO_LIGHT columns (4, .w unused), NORMAL_TO_LIGHT columns (3, .w unused)
+			enum : uint32_t { InstanceTextureUnit = TextureCount, InstanceTexels = 11 };
+			GLuint INSTANCE_BASE_int = -1U; //uniform location for the batch's first instance (-1 => use the plain uniforms)
 		} pipeline;
 	};
 
 	struct Camera {
 		//a 'Camera' attaches camera data to a transform:
-		Camera(Transform *transform_) : transform(transform_) { assert(transform); }
-		Transform * transform;
+		Camera(uint32_t transform_) : transform(transform_) { assert(transform != -1U); }
+		uint32_t transform; //index into Scene::transforms
 		//NOTE: cameras are directed along their -z axis
 
 		//perspective camera parameters:
@@ -97,8 +114,8 @@ struct Scene {
 
 	struct Light {
 		//a 'Light' attaches light data to a transform:
-		Light(Transform *transform_) : transform(transform_) { assert(transform); }
-		Transform * transform;
+		Light(uint32_t transform_) : transform(transform_) { assert(transform != -1U); }
+		uint32_t transform; //index into Scene::transforms
 		//NOTE: directional, spot, and hemisphere lights are directed along their -z axis
 
 		enum Type : char {
@@ -117,11 +134,34 @@ struct Scene {
 	};
 
 	//Scenes, of course, may have many of the above objects:
-	std::list< Transform > transforms;
-	std::list< Drawable > drawables;
+	// transforms and drawables are stored contiguously and referred to by index;
+	// transforms are kept in parent-before-child order so world matrices can be computed in one pass:
+	std::vector< Transform > transforms;
+	std::vector< Drawable > drawables;
+	// (cameras and lights are few, and game code holds pointers to them, so they stay in lists)
 	std::list< Camera > cameras;
 	std::list< Light > lights;
 
+	//append a transform (optionally as a child of an existing transform) and return its index:
+	uint32_t add_transform(uint32_t parent = -1U);
+
+	//make 'parent' (or -1U for none) the parent of transforms[transform], keeping parents before children:
+	// if 'parent' comes later, 'transform' and its descendants move to just after it, and every index
+	// stored in the scene (parents, drawables, cameras, lights) is updated. Indices held elsewhere must
+	// be updated with 'remap' (old index -> new index; left empty if nothing moved).
+	// Throws if 'parent' is 'transform' or one of its descendants.
+	void set_parent(uint32_t transform, uint32_t parent, std::vector< uint32_t > *remap = nullptr);
+
+	//world-space matrices for transforms[transform]:
+	// (these are cached, and only recomputed when position, rotation, scale, or parent --
+	//  of the transform or any ancestor -- have changed since they were last computed; not thread-safe)
+	glm::mat4x3 const &make_local_to_world(uint32_t transform) const;
+	glm::mat4x3 const &make_world_to_local(uint32_t transform) const;
+
+	//bring every transform's cached local-to-world matrix up to date in one linear pass:
+	// (stale matrices are recomputed as a batch -- see WorldMatrices.hpp; throws if some transform comes before its parent)
+	void update_world() const;
+
 	//The "draw" function provides a convenient way to pass all the things in a scene to OpenGL:
 	void draw(Camera const &camera) const;
 
@@ -132,22 +172,41 @@ struct Scene {
 	// the 'on_drawable' callback gives your code a chance to look up mesh data and make Drawables:
 	// throws on file format errors
 	void load(std::string const &filename,
-		std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable = nullptr
+		std::function< void(Scene &, uint32_t, std::string const &) > const &on_drawable = nullptr
 	);
 
 	//this function is called to read extra chunks from the scene file after the main chunks are read:
 	// this is useful if you, e.g., subclassing scene to represent a game level/area
-	virtual void load_extra(std::istream &from, std::vector< char > const &str0, std::vector< Transform * > const &xfh0) { }
+	virtual void load_extra(std::istream &from, std::vector< char > const &str0, std::vector< uint32_t > const &xfh0) { }
 
 	//empty scene:
 	Scene() = default;
 
 	//load a scene:
-	Scene(std::string const &filename, std::function< void(Scene &, Transform *, std::string const &) > const &on_drawable);
-
-	//copy a scene (with proper pointer fixup):
-	Scene(Scene const &); //...as a constructor
-	Scene &operator=(Scene const &); //...as scene = scene
-	//... as a set() function that optionally returns the transform->transform mapping:
-	void set(Scene const &, std::unordered_map< Transform const *, Transform * > *transform_map = nullptr);
+	Scene(std::string const &filename, std::function< void(Scene &, uint32_t, std::string const &) > const &on_drawable);
+
+	//copy a scene (everything refers to transforms by index, so no fixup is needed):
+	Scene(Scene const &) = default;
+	Scene &operator=(Scene const &) = default;
+	virtual ~Scene() = default;
+
+	//source of WorldCache::version values:
+	mutable uint64_t next_world_version = 1;
+	//if transforms[transform]'s inputs (or its parent's matrix) changed, record them in its cache, give it
+	// a new version, and return true -- its local_to_world then needs recomputing (parent must be up to date):
+	bool mark_world_stale(uint32_t transform) const;
+	//transforms marked stale by update_world, recomputed together with compute_world_matrices:
+	mutable std::vector< uint32_t > stale_transforms;
+
+	//drawable indices sorted by GL state (program, vertex array, textures, vertex range), kept between draws:
+	mutable std::vector< uint32_t > draw_order;
+	//per-instance matrices for this draw's instanced batches (RGBA32F texels, see Pipeline::InstanceTexels):
+	mutable std::vector< glm::vec4 > instance_data;
+	//this draw's calls: draw_order[begin, end) drawn together starting at instance instance_base,
+	// or a single drawable (end == begin + 1) drawn with plain uniforms if instance_base is -1:
+	struct DrawRun {
+		uint32_t begin, end;
+		int32_t instance_base;
+	};
+	mutable std::vector< DrawRun > draw_runs;
 };
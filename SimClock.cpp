@@ -0,0 +1,29 @@
+#include "SimClock.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+uint32_t SimClock::advance(float real_elapsed) {
+	assert(step > 0.0f);
+
+	uint32_t steps;
+	if (uncapped) {
+		steps = max_steps;
+	} else {
+		accumulator += double(real_elapsed) * double(time_scale);
+		double available = std::floor(accumulator / double(step));
+		if (available > double(max_steps)) {
+			//can't keep up; drop the backlog rather than falling further behind:
+			steps = max_steps;
+			accumulator = 0.0;
+		} else {
+			steps = uint32_t(available);
+			accumulator -= double(steps) * double(step);
+		}
+	}
+
+	ticks += steps;
+	time = double(ticks) * double(step);
+	return steps;
+}
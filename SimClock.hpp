@@ -0,0 +1,33 @@
+#pragma once
+
+/*
+ * SimClock turns (real) frame time into a whole number of fixed-size
+ *  simulation steps, so that simulation results don't depend on frame rate.
+ *
+ * - 'step' is the simulated duration of one update (seconds)
+ * - 'time_scale' is simulated seconds per real second (e.g., 60 plays a minute per second)
+ * - 'uncapped' ignores real time and runs 'max_steps' steps per advance() (as fast as possible)
+ *
+ * Given the same seed and inputs, a sequence of fixed steps gives identical results.
+ */
+
+#include <cstdint>
+
+struct SimClock {
+	float step = 1.0f / 60.0f;
+	float time_scale = 1.0f;
+	bool uncapped = false;
+
+	//limit on steps per advance() call (avoids spiral of death when frames are slow):
+	uint32_t max_steps = 10000;
+
+	//accumulate 'real_elapsed' seconds of wall-clock time, return number of steps to run:
+	uint32_t advance(float real_elapsed);
+
+	//total simulated time and steps so far:
+	double time = 0.0;
+	uint64_t ticks = 0;
+
+	//simulated time not yet consumed by a step:
+	double accumulator = 0.0;
+};
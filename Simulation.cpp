@@ -0,0 +1,107 @@
+#include "Simulation.hpp"
+
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+Simulation::Simulation(WalkMesh const &walkmesh_, TravelTimes const &travel_times_, glm::vec3 const &start, uint32_t seed, uint32_t couriers)
+	: walkmesh(walkmesh_), travel_times(travel_times_), order_controller(seed), fleet(walkmesh_), dispatcher(std::make_unique< GreedyDispatcher >()) {
+	WalkPoint at = walkmesh.nearest_walk_point(start);
+	for (uint32_t i = 0; i < couriers; ++i) {
+		fleet.add_courier(at);
+	}
+}
+
+void Simulation::update(float elapsed) {
+	time += elapsed;
+	order_controller.update(elapsed);
+	fleet.update(elapsed, pool);
+	update_jobs();
+}
+
+float Simulation::orders_per_hour() const {
+	return (time > 0.0 ? float(order_controller.delivered_orders / (time / 3600.0)) : 0.0f);
+}
+
+float Simulation::on_time_rate() const {
+	uint32_t finished = order_controller.delivered_orders + order_controller.expired_orders;
+	return (finished > 0 ? order_controller.delivered_orders / float(finished) : 0.0f);
+}
+
+void Simulation::update_jobs() {
+	//drop stops for orders that expired before the courier got there:
+	for (uint32_t i = 0; i < fleet.size(); ++i) {
+		auto &stops = fleet.stops[i];
+		if (stops.empty()) continue;
+		auto expired = [this](Fleet::Stop const &stop) {
+			return !order_controller.accepted_orders_.contains(stop.order);
+		};
+		bool retarget = expired(stops.front());
+		stops.erase(std::remove_if(stops.begin(), stops.end(), expired), stops.end());
+		if (retarget && !stops.empty()) {
+			fleet.set_target(i, get_location_position(stops.front().location));
+		}
+	}
+
+	//arrivals -- same rules as PlayMode::update_order, applied automatically:
+	for (uint32_t i = 0; i < fleet.size(); ++i) {
+		if (fleet.idle(i) || !fleet.at_target(i, order_dis)) continue;
+		Fleet::Stop const &stop = fleet.stops[i].front();
+		if (stop.pickup) {
+			order_controller.pickup_order(stop.location, i);
+		} else {
+			order_controller.deliver_order(stop.location, i);
+		}
+		fleet.stops[i].erase(fleet.stops[i].begin());
+		if (!fleet.idle(i)) {
+			fleet.set_target(i, get_location_position(fleet.stops[i].front().location));
+		}
+	}
+
+	//dispatch:
+	if (order_controller.pending_orders_.empty() || !dispatcher) return;
+	assignments.clear();
+	dispatcher->dispatch(DispatchContext{time, order_controller, fleet, travel_times}, &assignments);
+	if (assignments.empty()) return;
+
+	//accept orders and insert their stops (in the order given, since insertion indices build on earlier assignments):
+	for (Assignment const &a : assignments) {
+		OrderId accepted;
+		if (!order_controller.accept_pending_order(a.order, a.courier, &accepted)) continue;
+		Order const &order = *order_controller.accepted_orders_.get(accepted);
+		auto &stops = fleet.stops[a.courier];
+		bool was_idle = stops.empty();
+		stops.insert(stops.begin() + a.pickup_at, Fleet::Stop{order.store, true, 0.0, accepted});
+		stops.insert(stops.begin() + a.deliver_at, Fleet::Stop{order.client, false, order.deadline, accepted});
+		if (was_idle || a.pickup_at == 0) {
+			fleet.set_target(a.courier, get_location_position(stops.front().location));
+		}
+	}
+}
+
+struct SimulationState {
+	uint32_t version;
+	uint32_t padding;
+	double time;
+	uint64_t mesh_fingerprint;
+};
+
+void Simulation::save(std::ostream *to) const {
+	write_chunk_value("sim0", SimulationState{1, 0, time, travel_times.mesh_fingerprint}, to);
+	order_controller.save(to);
+	fleet.save(to);
+	if (dispatcher) dispatcher->save(to);
+	else GreedyDispatcher().save(to);
+}
+
+void Simulation::load(std::istream &from) {
+	SimulationState state = read_chunk_value< SimulationState >(from, "sim0");
+	if (state.version != 1) throw std::runtime_error("Unknown simulation snapshot version " + std::to_string(state.version) + ".");
+	if (state.mesh_fingerprint != travel_times.mesh_fingerprint) throw std::runtime_error("Simulation snapshot is from a different walkmesh.");
+	order_controller.load(from);
+	fleet.load(from);
+	if (dispatcher) dispatcher->load(from);
+	else GreedyDispatcher().load(from);
+	time = state.time;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+/*
+ * A Simulation runs the dispatch loop without SDL or OpenGL:
+ *  - an OrderController generates and expires orders
+ *  - a Dispatcher assigns pending orders to couriers (as pickup / delivery stops)
+ *  - a Fleet of scripted couriers drives (along routes over the walkmesh) from stop to stop
+ *
+ * It is used by the 'headless' executable to run many shifts quickly.
+ */
+
+#include "WalkMesh.hpp"
+#include "OrderController.hpp"
+#include "Fleet.hpp"
+#include "Dispatcher.hpp"
+#include "TravelTimes.hpp"
+
+#include <glm/glm.hpp>
+
+#include <iosfwd>
+#include <memory>
+
+struct Simulation {
+	//'couriers' couriers start at the walk point nearest to 'start'; 'seed' fixes the order stream:
+	// (travel_times must be built for the same walkmesh, and outlive the simulation)
+	Simulation(WalkMesh const &walkmesh, TravelTimes const &travel_times, glm::vec3 const &start, uint32_t seed, uint32_t couriers = 1);
+
+	//advance the simulation by 'elapsed' seconds (call with SimClock::step for reproducible runs):
+	void update(float elapsed);
+
+	//tuning (matches PlayMode's car):
+	float order_dis = 2.0f;
+
+	WalkMesh const &walkmesh;
+	TravelTimes const &travel_times;
+	OrderController order_controller;
+	Fleet fleet;
+	//assigns orders every tick (defaults to a GreedyDispatcher):
+	std::unique_ptr< Dispatcher > dispatcher;
+
+	//(optional) pool used to move the fleet in parallel; not owned:
+	ThreadPool *pool = nullptr;
+
+	//send order and courier events to 'recorder' (nullptr to stop); not owned:
+	void set_recorder(EventRecorder *recorder) {
+		order_controller.recorder = recorder;
+		fleet.recorder = recorder;
+	}
+
+	//total simulated time (in seconds):
+	double time = 0.0;
+
+	//write / restore the full simulation state (clock, orders, demand streams, couriers, dispatcher) as chunks:
+	// load into a simulation built on the same walkmesh, demand model, and location catalog; continuing
+	// with the same dispatcher matches an uninterrupted run exactly. load throws on format errors.
+	void save(std::ostream *to) const;
+	void load(std::istream &from);
+
+	//delivered orders per simulated hour, and fraction of finished orders delivered before expiring:
+	float orders_per_hour() const;
+	float on_time_rate() const;
+
+private:
+	//handle arrivals at stops, then dispatch pending orders:
+	void update_jobs();
+	std::vector< Assignment > assignments; //(scratch space for update_jobs)
+};
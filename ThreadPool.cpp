@@ -0,0 +1,137 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+ThreadPool::ThreadPool(uint32_t threads) {
+	threads = std::max(1U, threads);
+	for (uint32_t i = 0; i < threads; ++i) {
+		queues.emplace_back(std::make_unique< Queue >());
+	}
+	for (uint32_t i = 1; i < threads; ++i) {
+		workers.emplace_back(&ThreadPool::worker_main, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock< std::mutex > lock(wake_mutex);
+		quit = true;
+	}
+	wake_cv.notify_all();
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::parallel_for(uint32_t count, uint32_t grain, std::function< void(uint32_t, uint32_t) > const &fn) {
+	if (count == 0) return;
+	grain = std::max(1U, grain);
+
+	//small jobs (or no workers) run inline:
+	if (workers.empty() || count <= grain) {
+		fn(0, count);
+		return;
+	}
+
+	std::unique_lock< std::mutex > submit_lock(submit_mutex);
+
+	//deal chunks out round-robin:
+	uint32_t chunks = (count + grain - 1) / grain;
+	assert(unfinished == 0);
+	unfinished = chunks;
+	for (uint32_t c = 0; c < chunks; ++c) {
+		Task task;
+		task.fn = &fn;
+		task.begin = c * grain;
+		task.end = std::min(count, task.begin + grain);
+		Queue &queue = *queues[c % queues.size()];
+		std::unique_lock< std::mutex > lock(queue.mutex);
+		queue.tasks.emplace_back(task);
+		queued += 1;
+	}
+	{ //(lock so a worker can't miss the wakeup between checking 'queued' and waiting)
+		std::unique_lock< std::mutex > lock(wake_mutex);
+	}
+	wake_cv.notify_all();
+
+	//help out until nothing is left to take:
+	Task task;
+	while (pop_or_steal(0, &task)) {
+		run(task);
+	}
+
+	//wait for chunks still running on workers:
+	{
+		std::unique_lock< std::mutex > lock(wake_mutex);
+		done_cv.wait(lock, [this](){ return unfinished == 0; });
+	}
+
+	//pass along the first exception, as the inline path would:
+	if (failed) {
+		std::exception_ptr thrown;
+		{
+			std::unique_lock< std::mutex > lock(error_mutex);
+			std::swap(thrown, error);
+		}
+		failed = false;
+		std::rethrow_exception(thrown);
+	}
+}
+
+bool ThreadPool::pop_or_steal(uint32_t self, Task *task) {
+	assert(task);
+	//own queue first (from the back, most recently dealt):
+	{
+		Queue &queue = *queues[self];
+		std::unique_lock< std::mutex > lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			*task = queue.tasks.back();
+			queue.tasks.pop_back();
+			queued -= 1;
+			return true;
+		}
+	}
+	//then steal from the front of everyone else's:
+	for (uint32_t offset = 1; offset < queues.size(); ++offset) {
+		Queue &queue = *queues[(self + offset) % queues.size()];
+		std::unique_lock< std::mutex > lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			*task = queue.tasks.front();
+			queue.tasks.pop_front();
+			queued -= 1;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::run(Task const &task) {
+	//(exceptions are kept for parallel_for to rethrow; letting them leave a worker would terminate the program)
+	if (!failed) {
+		try {
+			(*task.fn)(task.begin, task.end);
+		} catch (...) {
+			std::unique_lock< std::mutex > lock(error_mutex);
+			if (!error) error = std::current_exception();
+			failed = true;
+		}
+	}
+	if (unfinished.fetch_sub(1) == 1) {
+		std::unique_lock< std::mutex > lock(wake_mutex);
+		done_cv.notify_all();
+	}
+}
+
+void ThreadPool::worker_main(uint32_t self) {
+	while (true) {
+		Task task;
+		if (pop_or_steal(self, &task)) {
+			run(task);
+			continue;
+		}
+		std::unique_lock< std::mutex > lock(wake_mutex);
+		wake_cv.wait(lock, [this](){ return quit || queued > 0; });
+		if (quit) return;
+	}
+}
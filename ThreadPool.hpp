@@ -0,0 +1,72 @@
+#pragma once
+
+/*
+ * ThreadPool runs ranges of a loop on several threads.
+ *
+ * Each worker has its own queue of chunks; idle workers steal from the
+ *  front of other workers' queues, so uneven chunks still balance out.
+ * The calling thread works on chunks too while it waits.
+ *
+ * Chunking only depends on 'count' and 'grain' (not on the number of threads),
+ *  so code whose chunks write disjoint data gives the same results for any pool size.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ThreadPool {
+	//'threads' includes the calling thread (so ThreadPool(1) runs everything inline):
+	explicit ThreadPool(uint32_t threads = std::max(1U, std::thread::hardware_concurrency()));
+	~ThreadPool();
+
+	ThreadPool(ThreadPool const &) = delete;
+	ThreadPool &operator=(ThreadPool const &) = delete;
+
+	//call fn(begin, end) for consecutive ranges of at most 'grain' items covering [0, count):
+	// returns once every range has finished.
+	// if 'fn' throws, ranges not yet started are skipped and the first exception is rethrown here.
+	// (not re-entrant: don't call from inside 'fn')
+	void parallel_for(uint32_t count, uint32_t grain, std::function< void(uint32_t, uint32_t) > const &fn);
+
+	uint32_t size() const { return uint32_t(queues.size()); }
+
+	//internals:
+	struct Task {
+		std::function< void(uint32_t, uint32_t) > const *fn = nullptr;
+		uint32_t begin = 0;
+		uint32_t end = 0;
+	};
+	struct Queue {
+		std::mutex mutex;
+		std::deque< Task > tasks;
+	};
+	//queues[0] belongs to the calling thread, queues[i] to workers[i-1]:
+	std::vector< std::unique_ptr< Queue > > queues;
+	std::vector< std::thread > workers;
+
+	bool pop_or_steal(uint32_t self, Task *task);
+	void run(Task const &task);
+	void worker_main(uint32_t self);
+
+	std::mutex submit_mutex; //one parallel_for at a time
+
+	std::mutex wake_mutex;
+	std::condition_variable wake_cv; //signalled when tasks are queued or on shutdown
+	std::condition_variable done_cv; //signalled when the last task finishes
+	std::atomic< uint32_t > queued{0}; //tasks sitting in queues
+	std::atomic< uint32_t > unfinished{0}; //tasks queued or running
+	bool quit = false;
+
+	//first exception thrown by a task during the current parallel_for (later tasks are skipped once set):
+	std::mutex error_mutex;
+	std::exception_ptr error;
+	std::atomic< bool > failed{false};
+};
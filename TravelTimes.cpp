@@ -0,0 +1,207 @@
+#include "TravelTimes.hpp"
+
+#include "Router.hpp"
+#include "read_write_chunk.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+TravelTimes::TravelTimes(WalkMesh const &walkmesh, float speed_, float spacing_, ThreadPool *pool) : TravelTimes(walkmesh, speed_, spacing_, true) {
+	build_points(walkmesh);
+	build_distances(walkmesh, pool);
+}
+
+TravelTimes::TravelTimes(WalkMesh const &walkmesh, float speed_, float spacing_, bool) : speed(speed_), inv_speed(1.0f / speed_), spacing(spacing_) {
+	if (!(speed > 0.0f)) throw std::runtime_error("TravelTimes speed must be positive.");
+	if (!(spacing > 0.0f)) throw std::runtime_error("TravelTimes spacing must be positive.");
+
+	mesh_fingerprint = fingerprint(walkmesh);
+}
+
+void TravelTimes::build_points(WalkMesh const &walkmesh) {
+	points.clear();
+
+	//locations first:
+	for (uint32_t l = 0; l < get_location_count(); ++l) {
+		points.emplace_back(get_location_position(Location(l)));
+	}
+
+	//grid over the walkmesh's xy bounds:
+	glm::vec2 min = glm::vec2( std::numeric_limits< float >::infinity());
+	glm::vec2 max = glm::vec2(-std::numeric_limits< float >::infinity());
+	for (auto const &v : walkmesh.vertices) {
+		min = glm::min(min, glm::vec2(v));
+		max = glm::max(max, glm::vec2(v));
+	}
+	grid_min = min;
+	grid_size = glm::uvec2(
+		std::max(1U, uint32_t(std::ceil((max.x - min.x) / spacing))),
+		std::max(1U, uint32_t(std::ceil((max.y - min.y) / spacing)))
+	);
+
+	//one sample per cell whose center is within half a cell of the walkmesh (so narrow roads still get samples):
+	auto cell_center = [&](uint32_t x, uint32_t y) {
+		return grid_min + (glm::vec2(float(x), float(y)) + 0.5f) * spacing;
+	};
+	for (uint32_t y = 0; y < grid_size.y; ++y) {
+		for (uint32_t x = 0; x < grid_size.x; ++x) {
+			glm::vec2 center = cell_center(x, y);
+			glm::vec3 on_mesh = walkmesh.to_world_point(walkmesh.nearest_walk_point(glm::vec3(center, 0.0f)));
+			if (glm::distance(glm::vec2(on_mesh), center) <= 0.5f * spacing) {
+				points.emplace_back(on_mesh);
+			}
+		}
+	}
+	count = uint32_t(points.size());
+
+	//nearest point to each cell center:
+	grid_nearest.assign(grid_size.x * grid_size.y, 0);
+	for (uint32_t y = 0; y < grid_size.y; ++y) {
+		for (uint32_t x = 0; x < grid_size.x; ++x) {
+			glm::vec2 center = cell_center(x, y);
+			float best = std::numeric_limits< float >::infinity();
+			for (uint32_t p = 0; p < count; ++p) {
+				glm::vec2 d = glm::vec2(points[p]) - center;
+				float dis2 = glm::dot(d, d);
+				if (dis2 < best) {
+					best = dis2;
+					grid_nearest[y * grid_size.x + x] = p;
+				}
+			}
+		}
+	}
+}
+
+void TravelTimes::build_distances(WalkMesh const &walkmesh, ThreadPool *pool) {
+	Router router(walkmesh);
+
+	std::vector< WalkPoint > at;
+	at.reserve(count);
+	for (auto const &p : points) {
+		at.emplace_back(walkmesh.nearest_walk_point(p));
+	}
+
+	distances.assign(count * count, 0.0f);
+
+	//row 'from' fills the upper triangle of the table (and mirrors it, routes are symmetric):
+	auto do_rows = [&](uint32_t begin, uint32_t end) {
+		Route route;
+		for (uint32_t from = begin; from < end; ++from) {
+			for (uint32_t to = from + 1; to < count; ++to) {
+				float dis = std::numeric_limits< float >::infinity();
+				if (router.route(at[from], at[to], &route)) dis = route.length;
+				distances[from * count + to] = dis;
+				distances[to * count + from] = dis;
+			}
+		}
+	};
+	if (pool) {
+		pool->parallel_for(count, 1, do_rows);
+	} else {
+		do_rows(0, count);
+	}
+}
+
+uint32_t TravelTimes::nearest_point(glm::vec3 const &world_point) const {
+	glm::vec2 local = (glm::vec2(world_point) - grid_min) / spacing;
+	uint32_t x = uint32_t(std::min(float(grid_size.x - 1), std::max(0.0f, std::floor(local.x))));
+	uint32_t y = uint32_t(std::min(float(grid_size.y - 1), std::max(0.0f, std::floor(local.y))));
+	return grid_nearest[y * grid_size.x + x];
+}
+
+float TravelTimes::time(glm::vec3 const &from, Location to) const {
+	uint32_t p = nearest_point(from);
+	return (glm::distance(from, points[p]) + distance(p, point(to))) * inv_speed;
+}
+
+uint64_t TravelTimes::fingerprint(WalkMesh const &walkmesh) {
+	//FNV-1a over the mesh data and location positions:
+	uint64_t hash = 14695981039346656037ULL;
+	auto add = [&hash](void const *data, size_t size) {
+		uint8_t const *bytes = reinterpret_cast< uint8_t const * >(data);
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * 1099511628211ULL;
+		}
+	};
+	add(walkmesh.vertices.data(), walkmesh.vertices.size() * sizeof(glm::vec3));
+	add(walkmesh.triangles.data(), walkmesh.triangles.size() * sizeof(glm::uvec3));
+	for (uint32_t l = 0; l < get_location_count(); ++l) {
+		glm::vec3 position = get_location_position(Location(l));
+		add(&position, sizeof(position));
+	}
+	return hash;
+}
+
+std::string TravelTimes::cache_path(std::string const &walkmeshes_path, std::string const &mesh_name) {
+	return walkmeshes_path + "." + mesh_name + ".times";
+}
+
+//cache file layout: header chunk, then points, nearest point per grid cell, and the distance table:
+// (the points and grid are stored so a cache hit doesn't have to search the walkmesh for them again)
+struct TravelTimesHeader {
+	uint64_t fingerprint;
+	float spacing;
+	uint32_t count;
+	glm::vec2 grid_min;
+	glm::uvec2 grid_size;
+};
+static_assert(sizeof(TravelTimesHeader) == 32, "TravelTimesHeader is packed.");
+
+TravelTimes TravelTimes::load_or_build(std::string const &cache_path, WalkMesh const &walkmesh, float speed, float spacing, ThreadPool *pool) {
+	TravelTimes ret(walkmesh, speed, spacing, true);
+
+	//try the cache:
+	std::ifstream in(cache_path, std::ios::binary);
+	if (in) {
+		try {
+			std::vector< TravelTimesHeader > header;
+			read_chunk(in, "tth1", &header);
+			if (header.size() == 1
+			 && header[0].fingerprint == ret.mesh_fingerprint
+			 && header[0].spacing == ret.spacing) {
+				read_chunk(in, "ttp0", &ret.points);
+				read_chunk(in, "ttn0", &ret.grid_nearest);
+				read_chunk(in, "ttd0", &ret.distances);
+				ret.count = header[0].count;
+				ret.grid_min = header[0].grid_min;
+				ret.grid_size = header[0].grid_size;
+				if (ret.points.size() == ret.count
+				 && ret.count >= get_location_count()
+				 && ret.grid_nearest.size() == size_t(ret.grid_size.x) * ret.grid_size.y
+				 && !ret.grid_nearest.empty()
+				 && std::all_of(ret.grid_nearest.begin(), ret.grid_nearest.end(), [&ret](uint32_t p){ return p < ret.count; })
+				 && ret.distances.size() == size_t(ret.count) * ret.count) {
+					return ret;
+				}
+			}
+		} catch (std::exception const &e) {
+			std::cerr << "WARNING: ignoring travel time cache '" << cache_path << "': " << e.what() << std::endl;
+		}
+	}
+
+	//build and (re)write the cache:
+	ret.build_points(walkmesh);
+	ret.build_distances(walkmesh, pool);
+
+	std::ofstream out(cache_path, std::ios::binary);
+	if (out) {
+		std::vector< TravelTimesHeader > header(1);
+		header[0].fingerprint = ret.mesh_fingerprint;
+		header[0].spacing = ret.spacing;
+		header[0].count = ret.count;
+		header[0].grid_min = ret.grid_min;
+		header[0].grid_size = ret.grid_size;
+		write_chunk("tth1", header, &out);
+		write_chunk("ttp0", ret.points, &out);
+		write_chunk("ttn0", ret.grid_nearest, &out);
+		write_chunk("ttd0", ret.distances, &out);
+	}
+	if (!out) {
+		std::cerr << "WARNING: failed to write travel time cache '" << cache_path << "'." << std::endl;
+	}
+	return ret;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+/*
+ * TravelTimes is a precomputed table of route lengths over one WalkMesh between
+ *  every pair of "points": all Location values, then a grid of sample points
+ *  covering the mesh (for estimating trips that start somewhere in between).
+ *
+ * Tables are built with Router in parallel (one row per task) and cached (along with
+ *  the points and sample grid) in a file next to the walkmeshes, so later runs only read them back.
+ */
+
+#include "WalkMesh.hpp"
+#include "OrderModels.hpp"
+#include "ThreadPool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TravelTimes {
+	//build the table for 'walkmesh' with sample points every 'spacing' units (in xy):
+	// 'speed' (units/second) converts distances to times.
+	TravelTimes(WalkMesh const &walkmesh, float speed, float spacing = 2.0f, ThreadPool *pool = nullptr);
+
+	//read the table cached in 'cache_path' if it matches 'walkmesh' and 'spacing',
+	// otherwise build it and (try to) write the cache:
+	static TravelTimes load_or_build(std::string const &cache_path, WalkMesh const &walkmesh, float speed, float spacing = 2.0f, ThreadPool *pool = nullptr);
+
+	//cache file used for the walkmesh named 'mesh_name' loaded from 'walkmeshes_path' (e.g., data_path("delivery.w")):
+	static std::string cache_path(std::string const &walkmeshes_path, std::string const &mesh_name);
+
+	//point index of a location (locations come first, in enum order):
+	static uint32_t point(Location loc) { return uint32_t(loc); }
+	//index of the point nearest (in xy) to 'world_point' -- a grid lookup:
+	uint32_t nearest_point(glm::vec3 const &world_point) const;
+
+	//route length / travel time between the walk points nearest two points (infinity if unreachable):
+	float distance(uint32_t from, uint32_t to) const { return distances[from * count + to]; }
+	float time(uint32_t from, uint32_t to) const { return distance(from, to) * inv_speed; }
+
+	float distance(Location from, Location to) const { return distance(point(from), point(to)); }
+	float time(Location from, Location to) const { return time(point(from), point(to)); }
+
+	//estimated travel time from an arbitrary point (on the walkmesh) to a location:
+	float time(glm::vec3 const &from, Location to) const;
+
+	float speed = 1.0f;
+	float inv_speed = 1.0f;
+	float spacing = 2.0f;
+
+	uint32_t count = 0; //number of points
+	std::vector< glm::vec3 > points; //location positions (as given), then grid samples (on the walkmesh)
+	std::vector< float > distances; //count x count, row 'from', column 'to'
+
+	//sample grid (cell size 'spacing') and the nearest point to each cell's center:
+	glm::vec2 grid_min = glm::vec2(0.0f);
+	glm::uvec2 grid_size = glm::uvec2(0);
+	std::vector< uint32_t > grid_nearest;
+
+	//fingerprint of the walkmesh and locations the table was built for (used to validate caches):
+	static uint64_t fingerprint(WalkMesh const &walkmesh);
+	uint64_t mesh_fingerprint = 0;
+
+private:
+	//check parameters and fingerprint the walkmesh (the rest is built, or read from the cache):
+	TravelTimes(WalkMesh const &walkmesh, float speed, float spacing, bool);
+	//set up points and sample grid:
+	void build_points(WalkMesh const &walkmesh);
+	//fill in distances:
+	void build_distances(WalkMesh const &walkmesh, ThreadPool *pool);
+};
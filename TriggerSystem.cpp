@@ -0,0 +1,71 @@
+#include "TriggerSystem.hpp"
+
+#include <glm/gtx/norm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+TriggerSystem::TriggerSystem(float cell_size_) : cell_size(cell_size_) {
+	if (!(cell_size > 0.0f)) throw std::runtime_error("TriggerSystem cell size must be positive.");
+}
+
+uint32_t TriggerSystem::add_zone(glm::vec3 const &center, float radius, uint32_t tag) {
+	uint32_t index = uint32_t(zones.size());
+	zones.emplace_back(Zone{center, radius, tag});
+
+	//add to every cell its (xy) bounding box touches:
+	int32_t x0 = int32_t(std::floor((center.x - radius) / cell_size));
+	int32_t x1 = int32_t(std::floor((center.x + radius) / cell_size));
+	int32_t y0 = int32_t(std::floor((center.y - radius) / cell_size));
+	int32_t y1 = int32_t(std::floor((center.y + radius) / cell_size));
+	for (int32_t y = y0; y <= y1; ++y) {
+		for (int32_t x = x0; x <= x1; ++x) {
+			cells[cell_key(x, y)].emplace_back(index);
+		}
+	}
+	return index;
+}
+
+uint32_t TriggerSystem::add_agent() {
+	inside.emplace_back();
+	return uint32_t(inside.size()) - 1;
+}
+
+void TriggerSystem::move_agent(uint32_t agent, glm::vec3 const &position, std::vector< Event > *events) {
+	assert(agent < inside.size());
+
+	//zones containing 'position' (only those bucketed in its cell can):
+	now_inside.clear();
+	auto f = cells.find(cell_key(int32_t(std::floor(position.x / cell_size)), int32_t(std::floor(position.y / cell_size))));
+	if (f != cells.end()) {
+		for (uint32_t z : f->second) {
+			Zone const &zone = zones[z];
+			if (glm::length2(position - zone.center) < zone.radius * zone.radius) {
+				now_inside.emplace_back(z);
+			}
+		}
+	}
+	std::sort(now_inside.begin(), now_inside.end());
+
+	//diff against the previous set (both sorted):
+	auto &was_inside = inside[agent];
+	if (events) {
+		auto a = was_inside.begin();
+		auto b = now_inside.begin();
+		while (a != was_inside.end() || b != now_inside.end()) {
+			if (b == now_inside.end() || (a != was_inside.end() && *a < *b)) {
+				events->emplace_back(Event{agent, *a, false});
+				++a;
+			} else if (a == was_inside.end() || *b < *a) {
+				events->emplace_back(Event{agent, *b, true});
+				++b;
+			} else {
+				++a;
+				++b;
+			}
+		}
+	}
+	was_inside.swap(now_inside);
+}
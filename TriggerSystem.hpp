@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+ * TriggerSystem tracks which trigger zones (spheres, e.g. around stores and
+ *  clients) each agent (e.g. the player, or a courier) is standing in.
+ *
+ * Zones are registered once and bucketed into a spatial hash over xy, so
+ *  moving an agent only tests the zones in its hash cell; changes are
+ *  reported as enter / exit events.
+ */
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct TriggerSystem {
+	//'cell_size' should be around the size of a typical zone:
+	explicit TriggerSystem(float cell_size = 4.0f);
+
+	struct Zone {
+		glm::vec3 center;
+		float radius;
+		uint32_t tag; //caller's data (e.g., a Location)
+	};
+	struct Event {
+		uint32_t agent;
+		uint32_t zone;
+		bool enter; //true on entering, false on leaving
+	};
+
+	//register a zone / agent and return its index:
+	// (agents start outside every zone, so their first move reports enters)
+	uint32_t add_zone(glm::vec3 const &center, float radius, uint32_t tag = 0);
+	uint32_t add_agent();
+
+	//update an agent's position; appends enter / exit events (if 'events' is given):
+	void move_agent(uint32_t agent, glm::vec3 const &position, std::vector< Event > *events = nullptr);
+
+	//zones an agent is inside (as of its last move):
+	std::vector< uint32_t > const &zones_of(uint32_t agent) const { return inside[agent]; }
+
+	float cell_size;
+	std::vector< Zone > zones;
+	//zones overlapping each (xy) cell:
+	std::unordered_map< uint64_t, std::vector< uint32_t > > cells;
+	//per-agent zones currently inside (kept sorted):
+	std::vector< std::vector< uint32_t > > inside;
+
+	uint64_t cell_key(int32_t x, int32_t y) const { return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y)); }
+
+private:
+	std::vector< uint32_t > now_inside; //(scratch space for move_agent)
+};
@@ -3,26 +3,58 @@
 #include "read_write_chunk.hpp"
 
 #include <glm/gtx/norm.hpp>
+#include <glm/gtx/hash.hpp> //allows the use of 'uvec2' as an unordered_map key
 #include <glm/gtx/string_cast.hpp>
 
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <cmath>
 #include <string>
 
 WalkMesh::WalkMesh(std::vector< glm::vec3 > const &vertices_, std::vector< glm::vec3 > const &normals_, std::vector< glm::uvec3 > const &triangles_)
 	: vertices(vertices_), normals(normals_), triangles(triangles_) {
 
-	//construct next_vertex map (maps each edge to the next vertex in the triangle):
-	next_vertex.reserve(triangles.size()*3);
-	auto do_next = [this](uint32_t a, uint32_t b, uint32_t c) {
-		auto ret = next_vertex.insert(std::make_pair(glm::uvec2(a,b), c));
-		assert(ret.second);
-	};
+	//construct edge_across table (pairs each edge with its reverse in the neighboring triangle):
+	{
+		//(the hash map is only used while building; walking just indexes edge_across)
+		std::unordered_map< glm::uvec2, uint32_t > edge_index;
+		edge_index.reserve(triangles.size()*3);
+		for (uint32_t ti = 0; ti < triangles.size(); ++ti) {
+			glm::uvec3 const &tri = triangles[ti];
+			for (uint32_t k = 0; k < 3; ++k) {
+				auto ret = edge_index.insert(std::make_pair(glm::uvec2(tri[k], tri[(k+1)%3]), 3*ti+k));
+				assert(ret.second);
+			}
+		}
+		edge_across.assign(triangles.size()*3, -1U);
+		for (auto const &e : edge_index) {
+			auto f = edge_index.find(glm::uvec2(e.first.y, e.first.x));
+			if (f != edge_index.end()) {
+				edge_across[e.second] = f->second;
+			}
+		}
+	}
+
+	//precompute per-triangle frames:
+	triangle_frames.reserve(triangles.size());
 	for (auto const &tri : triangles) {
-		do_next(tri.x, tri.y, tri.z);
-		do_next(tri.y, tri.z, tri.x);
-		do_next(tri.z, tri.x, tri.y);
+		TriangleFrame f;
+		f.a = vertices[tri.x];
+		f.ab = vertices[tri.y] - f.a;
+		f.ac = vertices[tri.z] - f.a;
+		f.normal = glm::normalize(glm::cross(f.ab, f.ac));
+		//dual basis computed in double precision from the (scaled) normal, so that long, thin
+		// triangles don't lose precision the way solving the 2x2 dot-product system would:
+		glm::dvec3 ab = glm::dvec3(f.ab);
+		glm::dvec3 ac = glm::dvec3(f.ac);
+		glm::dvec3 n = glm::cross(ab, ac);
+		double n2 = glm::dot(n, n);
+		//(degenerate triangles get a zero basis, so every step stays at the first vertex):
+		double inv_n2 = (n2 == 0.0 ? 0.0 : 1.0 / n2);
+		f.to_b = glm::vec3(glm::cross(ac, n) * inv_n2);
+		f.to_c = glm::vec3(glm::cross(n, ab) * inv_n2);
+		triangle_frames.emplace_back(f);
 	}
 
 	//DEBUG: are vertex normals consistent with geometric normals?
@@ -38,21 +70,76 @@ WalkMesh::WalkMesh(std::vector< glm::vec3 > const &vertices_, std::vector< glm::
 
 		assert(da > 0.1f && db > 0.1f && dc > 0.1f);
 	}
+
+	//build grid (aiming for about one triangle per cell):
+	if (!triangles.empty()) {
+		glm::vec2 min = glm::vec2( std::numeric_limits< float >::infinity());
+		glm::vec2 max = glm::vec2(-std::numeric_limits< float >::infinity());
+		for (auto const &v : vertices) {
+			min = glm::min(min, glm::vec2(v));
+			max = glm::max(max, glm::vec2(v));
+		}
+		glm::vec2 extent = glm::max(max - min, glm::vec2(1e-3f));
+		grid.min = min;
+		grid.cell_size = std::sqrt(extent.x * extent.y / float(triangles.size()));
+		grid.cell_size = std::max(grid.cell_size, std::max(extent.x, extent.y) / 4096.0f);
+		grid.size.x = std::max(1U, uint32_t(std::ceil(extent.x / grid.cell_size)));
+		grid.size.y = std::max(1U, uint32_t(std::ceil(extent.y / grid.cell_size)));
+
+		//cell range covered by a triangle's bounding box:
+		auto cell_range = [this](glm::uvec3 const &tri, glm::uvec2 *lo, glm::uvec2 *hi) {
+			glm::vec2 a = glm::vec2(vertices[tri.x]);
+			glm::vec2 b = glm::vec2(vertices[tri.y]);
+			glm::vec2 c = glm::vec2(vertices[tri.z]);
+			glm::vec2 tmin = (glm::min(a, glm::min(b, c)) - grid.min) / grid.cell_size;
+			glm::vec2 tmax = (glm::max(a, glm::max(b, c)) - grid.min) / grid.cell_size;
+			*lo = glm::uvec2(
+				std::min(grid.size.x - 1, uint32_t(std::max(0.0f, tmin.x))),
+				std::min(grid.size.y - 1, uint32_t(std::max(0.0f, tmin.y)))
+			);
+			*hi = glm::uvec2(
+				std::min(grid.size.x - 1, uint32_t(std::max(0.0f, tmax.x))),
+				std::min(grid.size.y - 1, uint32_t(std::max(0.0f, tmax.y)))
+			);
+		};
+
+		//count triangles per cell, then fill (compressed rows):
+		grid.cell_begin.assign(grid.size.x * grid.size.y + 1, 0);
+		for (auto const &tri : triangles) {
+			glm::uvec2 lo, hi;
+			cell_range(tri, &lo, &hi);
+			for (uint32_t y = lo.y; y <= hi.y; ++y) {
+				for (uint32_t x = lo.x; x <= hi.x; ++x) {
+					grid.cell_begin[y * grid.size.x + x + 1] += 1;
+				}
+			}
+		}
+		for (uint32_t i = 1; i < grid.cell_begin.size(); ++i) {
+			grid.cell_begin[i] += grid.cell_begin[i-1];
+		}
+		grid.cell_triangles.resize(grid.cell_begin.back());
+		std::vector< uint32_t > fill(grid.cell_begin.begin(), grid.cell_begin.end() - 1);
+		for (uint32_t ti = 0; ti < triangles.size(); ++ti) {
+			glm::uvec2 lo, hi;
+			cell_range(triangles[ti], &lo, &hi);
+			for (uint32_t y = lo.y; y <= hi.y; ++y) {
+				for (uint32_t x = lo.x; x <= hi.x; ++x) {
+					grid.cell_triangles[fill[y * grid.size.x + x]++] = ti;
+				}
+			}
+		}
+	}
 }
 
-//project pt to the plane of triangle a,b,c and return the barycentric weights of the projected point:
-glm::vec3 barycentric_weights(glm::vec3 const &a, glm::vec3 const &b, glm::vec3 const &c, glm::vec3 const &pt) {
-	//TODO: implement!
-	glm::vec3 ab = b-a;
-	glm::vec3 ac = c-a;
-	glm::vec3 n = glm::vec3(ab.y*ac.z-ab.z*ac.y, ac.x*ab.z-ab.x*ac.z, ab.x*ac.y-ab.y*ac.x);
-	float d = -(n.x*a.x+n.y*a.y+n.z*a.z);
-	float t = -(n.x*pt.x+n.y*pt.y+n.z*pt.z+d)/(n.x*n.x+n.y*n.y+n.z*n.z);
-	glm::vec3 proj = glm::vec3(pt.x+n.x*t, pt.y+n.y*t, pt.z+n.z*t);
-	glm::mat3 equation = glm::mat3(glm::vec3(a.x,a.y,a.z),glm::vec3(b.x,b.y,b.z),glm::vec3(c.x,c.y,c.z));
-	glm::vec3 res = glm::inverse(equation)*proj;
-	return res;
-	// return glm::vec3(0.25f, 0.25f, 0.5f);
+//reorder weights given in 'indices' order to match the order of 'tri' (which holds the same vertices):
+static glm::vec3 to_triangle_order(glm::uvec3 const &tri, glm::uvec3 const &indices, glm::vec3 const &weights) {
+	glm::vec3 ret;
+	for (uint32_t i = 0; i < 3; ++i) {
+		uint32_t j = (indices[i] == tri.x ? 0 : (indices[i] == tri.y ? 1 : 2));
+		assert(indices[i] == tri[j]);
+		ret[j] = weights[i];
+	}
+	return ret;
 }
 
 WalkPoint WalkMesh::nearest_walk_point(glm::vec3 const &world_point) const {
@@ -61,28 +148,24 @@ WalkPoint WalkMesh::nearest_walk_point(glm::vec3 const &world_point) const {
 	WalkPoint closest;
 	float closest_dis2 = std::numeric_limits< float >::infinity();
 
-	for (auto const &tri : triangles) {
+	auto check_triangle = [&world_point, &closest, &closest_dis2, this](uint32_t ti) {
 		//find closest point on triangle:
-
-		glm::vec3 const &a = vertices[tri.x];
-		glm::vec3 const &b = vertices[tri.y];
-		glm::vec3 const &c = vertices[tri.z];
+		glm::uvec3 const &tri = triangles[ti];
 
 		//get barycentric coordinates of closest point in the plane of (a,b,c):
-		glm::vec3 coords = barycentric_weights(a,b,c, world_point);
+		glm::vec3 coords = barycentric_weights(ti, world_point);
 
 		//is that point inside the triangle?
 		if (coords.x >= 0.0f && coords.y >= 0.0f && coords.z >= 0.0f) {
 			//yes, point is inside triangle.
-			float dis2 = glm::length2(world_point - to_world_point(WalkPoint(tri, coords)));
+			float dis2 = glm::length2(world_point - to_world_point(WalkPoint(tri, coords, ti)));
 			if (dis2 < closest_dis2) {
 				closest_dis2 = dis2;
-				closest.indices = tri;
-				closest.weights = coords;
+				closest = WalkPoint(tri, coords, ti);
 			}
 		} else {
 			//check triangle vertices and edges:
-			auto check_edge = [&world_point, &closest, &closest_dis2, this](uint32_t ai, uint32_t bi, uint32_t ci) {
+			auto check_edge = [&world_point, &closest, &closest_dis2, ti, this](uint32_t ai, uint32_t bi, uint32_t ci) {
 				glm::vec3 const &a = vertices[ai];
 				glm::vec3 const &b = vertices[bi];
 
@@ -106,14 +189,38 @@ WalkPoint WalkMesh::nearest_walk_point(glm::vec3 const &world_point) const {
 				float dis2 = glm::length2(world_point - pt);
 				if (dis2 < closest_dis2) {
 					closest_dis2 = dis2;
-					closest.indices = glm::uvec3(ai, bi, ci);
-					closest.weights = coords;
+					closest = WalkPoint(glm::uvec3(ai, bi, ci), coords, ti);
 				}
 			};
 			check_edge(tri.x, tri.y, tri.z);
 			check_edge(tri.y, tri.z, tri.x);
 			check_edge(tri.z, tri.x, tri.y);
 		}
+	};
+
+	//search rings of grid cells outward from the cell containing world_point:
+	glm::vec2 local = (glm::vec2(world_point) - grid.min) / grid.cell_size;
+	int32_t cx = int32_t(std::min(float(grid.size.x - 1), std::max(0.0f, std::floor(local.x))));
+	int32_t cy = int32_t(std::min(float(grid.size.y - 1), std::max(0.0f, std::floor(local.y))));
+	int32_t max_ring = int32_t(std::max(grid.size.x, grid.size.y));
+	for (int32_t ring = 0; ring <= max_ring; ++ring) {
+		//every cell in this ring is at least (ring-1) cells away, which bounds (xy, thus 3D) distance from below:
+		if (ring > 0) {
+			float bound = float(ring - 1) * grid.cell_size;
+			if (closest_dis2 <= bound * bound) break;
+		}
+		for (int32_t y = cy - ring; y <= cy + ring; ++y) {
+			if (y < 0 || y >= int32_t(grid.size.y)) continue;
+			//interior rows of the ring only contribute their two end cells:
+			int32_t x_step = (y == cy - ring || y == cy + ring ? 1 : std::max(1, 2 * ring));
+			for (int32_t x = cx - ring; x <= cx + ring; x += x_step) {
+				if (x < 0 || x >= int32_t(grid.size.x)) continue;
+				uint32_t cell = uint32_t(y) * grid.size.x + uint32_t(x);
+				for (uint32_t i = grid.cell_begin[cell]; i < grid.cell_begin[cell+1]; ++i) {
+					check_triangle(grid.cell_triangles[i]);
+				}
+			}
+		}
 	}
 	assert(closest.indices.x < vertices.size());
 	assert(closest.indices.y < vertices.size());
@@ -129,57 +236,45 @@ void WalkMesh::walk_in_triangle(WalkPoint const &start, glm::vec3 const &step, W
 	assert(time_);
 	auto &time = *time_;
 
-	glm::vec3 step_proj;
-	glm::vec3 wv;
-	glm::vec3 const &a = vertices[start.indices.x];
-	glm::vec3 const &b = vertices[start.indices.y];
-	glm::vec3 const &c = vertices[start.indices.z];
-	{ //project 'step' into a barycentric-coordinates direction:
-		//TODO
-		step_proj = barycentric_weights(a, b, c, to_world_point(start)+step);
-		// step_coords = glm::vec3(0.0f);
-		wv = step_proj-start.weights;
-	}
-	
+	assert(start.triangle < triangles.size());
+	glm::uvec3 const &tri = triangles[start.triangle];
+
+	//work with weights in triangles[start.triangle] (CCW) order:
+	glm::vec3 weights = to_triangle_order(tri, start.indices, start.weights);
+	//project 'step' into a barycentric-coordinates direction:
+	glm::vec3 wv = barycentric_direction(start.triangle, step);
+
 	//if no edge is crossed, event will just be taking the whole step:
 	time = 1.0f;
 	end = start;
 
-	//figure out which edge (if any) is crossed first.
-	// set time and end appropriately.
-	//TODO
-	if (step_proj.x >= 0 && step_proj.y >= 0 && step_proj.z >= 0){
-		end.weights = step_proj;
-		time = 1.0f;
-	} else {
-		if (step_proj.x < 0){
-			time = 1.0f-abs(step_proj.x/wv.x);
-			end.weights.x = start.weights.z + wv.z*time;
-			end.weights.y = start.weights.y + wv.y*time;
-			end.indices.x = start.indices.z;
-			end.indices.y = start.indices.y;
-			end.indices.z = start.indices.x;
-		} else if (step_proj.y < 0){
-			time = 1.0f-abs(step_proj.y/wv.y);
-			end.weights.x = start.weights.x + wv.z*time;
-			end.weights.y = start.weights.z + wv.x*time;
-			end.indices.x = start.indices.x;
-			end.indices.y = start.indices.z;
-			end.indices.z = start.indices.y;
-		} else if (step_proj.z < 0){
-			time = 1.0f-abs(step_proj.z/wv.z);
-			end.weights.x = start.weights.y + wv.y*time;
-			end.weights.y = start.weights.x + wv.x*time;
-			end.indices.x = start.indices.y;
-			end.indices.y = start.indices.x;
-			end.indices.z = start.indices.z;
+	//figure out which edge (if any) is crossed first (i.e., which weight hits zero first):
+	int32_t crossed = -1;
+	for (int32_t i = 0; i < 3; ++i) {
+		if (wv[i] < 0.0f) {
+			float t = -weights[i] / wv[i];
+			if (t < time) {
+				time = std::max(0.0f, t);
+				crossed = i;
+			}
 		}
-		
-		end.weights.z = 0.0f;
 	}
 
+	if (crossed == -1) {
+		end.indices = tri;
+		end.weights = weights + wv;
+		return;
+	}
+
+	weights += wv * time;
+
 	//Remember: our convention is that when a WalkPoint is on an edge,
 	// then wp.weights.z == 0.0f (so will likely need to re-order the indices)
+	//the edge's vertices are stored in reverse (CW) order, which is the CCW order of the triangle across the edge:
+	uint32_t i = (crossed + 1) % 3;
+	uint32_t j = (crossed + 2) % 3;
+	end.indices = glm::uvec3(tri[j], tri[i], tri[crossed]);
+	end.weights = glm::vec3(weights[j], weights[i], 0.0f);
 }
 
 bool WalkMesh::cross_edge(WalkPoint const &start, WalkPoint *end_, glm::quat *rotation_) const {
@@ -190,27 +285,35 @@ bool WalkMesh::cross_edge(WalkPoint const &start, WalkPoint *end_, glm::quat *ro
 	auto &rotation = *rotation_;
 
 	assert(start.weights.z == 0.0f); //*must* be on an edge.
-	glm::uvec2 edge = glm::uvec2(start.indices);
+	assert(start.triangle < triangles.size());
+	glm::uvec3 const &tri = triangles[start.triangle];
+
+	//find which of the triangle's edges (in either direction) the point is on:
+	uint32_t k = 0;
+	while (k < 3 && !(
+		(tri[k] == start.indices.y && tri[(k+1)%3] == start.indices.x)
+		|| (tri[k] == start.indices.x && tri[(k+1)%3] == start.indices.y)
+	)) ++k;
+	assert(k < 3);
+	uint32_t across = (k < 3 ? edge_across[3*start.triangle+k] : -1U);
 
 	//check if 'edge' is a non-boundary edge:
-	auto f = next_vertex.find(edge);
-	if (f != next_vertex.end()) {
+	if (across != -1U) {
 		//it is!
 
-		//make 'end' represent the same (world) point, but on triangle (edge.y, edge.x, [other point]):
-		//TODO
-		int next = f->second;
-		end.indices = glm::uvec3(start.indices.x, start.indices.y, next);
-		end.weights = start.weights;
+		//make 'end' represent the same (world) point, but on the other triangle, ordered (edge, [other point]):
+		uint32_t ti = across / 3;
+		uint32_t l = across % 3;
+		glm::uvec3 const &next = triangles[ti];
+		end.indices = glm::uvec3(next[l], next[(l+1)%3], next[(l+2)%3]);
+		if (end.indices.x == start.indices.x) {
+			end.weights = glm::vec3(start.weights.x, start.weights.y, 0.0f);
+		} else {
+			end.weights = glm::vec3(start.weights.y, start.weights.x, 0.0f);
+		}
+		end.triangle = ti;
 		//make 'rotation' the rotation that takes (start.indices)'s normal to (end.indices)'s normal:
-		//TODO
-		glm::vec3 a = vertices[start.indices.x];
-		glm::vec3 b = vertices[start.indices.y];
-		glm::vec3 c = vertices[start.indices.z];
-		glm::vec3 d = vertices[end.indices.z];
-		glm::vec3 old_norm = glm::cross(b-a, c-a);
-		glm::vec3 new_norm = glm::cross(a-b, d-b);
-		rotation = glm::rotation(glm::normalize(old_norm), glm::normalize(new_norm));
+		rotation = glm::rotation(triangle_frames[start.triangle].normal, triangle_frames[end.triangle].normal);
 		return true;
 	} else {
 		end = start;
@@ -219,6 +322,55 @@ bool WalkMesh::cross_edge(WalkPoint const &start, WalkPoint *end_, glm::quat *ro
 	}
 }
 
+glm::vec3 WalkMesh::walk(WalkPoint *at_, glm::vec3 const &step) const {
+	assert(at_);
+	auto &at = *at_;
+
+	glm::vec3 remain = step;
+	//using a for() instead of a while() here so that if walkpoint gets stuck in
+	// some awkward case, code will not infinite loop:
+	for (uint32_t iter = 0; iter < 10; ++iter) {
+		if (remain == glm::vec3(0.0f)) break;
+		WalkPoint end;
+		float time;
+		walk_in_triangle(at, remain, &end, &time);
+		at = end;
+		if (time == 1.0f) {
+			//finished within triangle:
+			remain = glm::vec3(0.0f);
+			break;
+		}
+		//some step remains:
+		remain *= (1.0f - time);
+		//try to step over edge:
+		glm::quat rotation;
+		if (cross_edge(at, &end, &rotation)) {
+			//stepped to a new triangle:
+			at = end;
+			//rotate step to follow surface:
+			remain = rotation * remain;
+		} else {
+			//ran into a wall, bounce / slide along it:
+			glm::vec3 const &a = vertices[at.indices.x];
+			glm::vec3 const &b = vertices[at.indices.y];
+			glm::vec3 const &c = vertices[at.indices.z];
+			glm::vec3 along = glm::normalize(b-a);
+			glm::vec3 normal = glm::normalize(glm::cross(b-a, c-a));
+			glm::vec3 in = glm::cross(normal, along);
+
+			//check how much 'remain' is pointing out of the triangle:
+			float d = glm::dot(remain, in);
+			if (d < 0.0f) {
+				//bounce off of the wall:
+				remain += (-1.25f * d) * in;
+			} else {
+				//if it's just pointing along the edge, bend slightly away from wall:
+				remain += 0.01f * d * in;
+			}
+		}
+	}
+	return remain;
+}
 
 WalkMeshes::WalkMeshes(std::string const &filename) {
 	std::ifstream file(filename, std::ios::binary);
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <glm/gtx/hash.hpp> //allows the use of 'uvec2' as an unordered_map key
+#include <glm/gtc/quaternion.hpp>
 
 #include <vector>
 #include <string>
@@ -14,7 +14,9 @@ struct WalkPoint {
 	//barycentric coordinates for current point:
 	glm::vec3 weights = glm::vec3(std::numeric_limits< float >::quiet_NaN());
 	//NOTE: by convention, if WalkPoint is on an edge, indices/weights will be arranged so that weights.z will be 0.0.
-	WalkPoint(glm::uvec3 const &indices_, glm::vec3 const &weights_) : indices(indices_), weights(weights_) { }
+	//index of current triangle in WalkMesh::triangles (indices holds the same vertices, possibly reordered):
+	uint32_t triangle = -1U;
+	WalkPoint(glm::uvec3 const &indices_, glm::vec3 const &weights_, uint32_t triangle_) : indices(indices_), weights(weights_), triangle(triangle_) { }
 	WalkPoint() = default;
 };
 
@@ -24,14 +26,51 @@ struct WalkMesh {
 	std::vector< glm::vec3 > normals; //normals for interpolated 'up' direction
 	std::vector< glm::uvec3 > triangles; //CCW-oriented
 
-	//This "next vertex" map includes [a,b]->c, [b,c]->a, and [c,a]->b for each triangle (a,b,c), and is useful for checking what's over an edge from a given point:
-	std::unordered_map< glm::uvec2, uint32_t > next_vertex;
+	//Triangle adjacency, for checking what's over an edge from a given point:
+	// edge 3*ti+k is [triangles[ti][k], triangles[ti][(k+1)%3]], and edge_across[3*ti+k]
+	// is the same edge (as 3*tj+l) in the neighboring triangle tj, or -1U for a boundary edge.
+	std::vector< uint32_t > edge_across;
+
+	//Per-triangle data precomputed at load time, so walking only needs a few dot products:
+	struct TriangleFrame {
+		glm::vec3 a; //first vertex (triangles[i].x)
+		glm::vec3 ab; //triangles[i].y - a
+		glm::vec3 ac; //triangles[i].z - a
+		glm::vec3 normal; //unit normal (CCW)
+		//dual basis: dot(p - a, to_b) and dot(p - a, to_c) are the b and c barycentric weights of p:
+		glm::vec3 to_b, to_c;
+	};
+	std::vector< TriangleFrame > triangle_frames;
+
+	//barycentric weights (in triangles[ti] order) of pt projected to triangle ti's plane:
+	glm::vec3 barycentric_weights(uint32_t ti, glm::vec3 const &pt) const {
+		TriangleFrame const &f = triangle_frames[ti];
+		glm::vec3 d = barycentric_direction(ti, pt - f.a);
+		return glm::vec3(1.0f + d.x, d.y, d.z);
+	}
+	//change in barycentric weights (in triangles[ti] order) from moving by step projected to triangle ti's plane:
+	glm::vec3 barycentric_direction(uint32_t ti, glm::vec3 const &step) const {
+		TriangleFrame const &f = triangle_frames[ti];
+		float y = glm::dot(step, f.to_b);
+		float z = glm::dot(step, f.to_c);
+		return glm::vec3(-y - z, y, z);
+	}
 
-	//Construct new WalkMesh and build next_vertex structure:
+	//Uniform grid over the triangles' (xy) bounding boxes, used by nearest_walk_point:
+	struct TriangleGrid {
+		glm::vec2 min = glm::vec2(0.0f); //corner of cell (0,0)
+		float cell_size = 1.0f;
+		glm::uvec2 size = glm::uvec2(0); //cells in x and y
+		//triangles overlapping cell (x,y) are cell_triangles[cell_begin[i]] .. cell_triangles[cell_begin[i+1]-1], where i = y*size.x+x:
+		std::vector< uint32_t > cell_begin;
+		std::vector< uint32_t > cell_triangles;
+	} grid;
+
+	//Construct new WalkMesh and build edge_across, triangle_frames, and grid structures:
 	WalkMesh(std::vector< glm::vec3 > const &vertices_, std::vector< glm::vec3 > const &normals_, std::vector< glm::uvec3 > const &triangles_);
 
 	//used to initialize walking -- finds the closest point on the walk mesh:
-	// (should only need to call this at the start of a level)
+	// (uses 'grid', so only triangles near world_point are checked)
 	WalkPoint nearest_walk_point(glm::vec3 const &world_point) const;
 
 
@@ -64,6 +103,15 @@ struct WalkMesh {
 		glm::quat *rotation     //[out] rotation over edge
 	) const;
 
+	//walk along the surface, repeatedly calling walk_in_triangle and cross_edge:
+	//  - *at is updated to the final position
+	//  - boundary edges deflect the step (bounce / slide along the wall)
+	//  - returns the part of the step left over if the iteration budget ran out (usually glm::vec3(0.0))
+	glm::vec3 walk(
+		WalkPoint *at,          //[in,out] location to walk from / to
+		glm::vec3 const &step   //[in] step to take (in world space)
+	) const;
+
 	//used to read back results of walking:
 	glm::vec3 to_world_point(WalkPoint const &wp) const {
 		//if you were looking here for the lesson solution, well, here you go:
@@ -0,0 +1,341 @@
+#include "WorldMatrices.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WORLD_MATRICES_X86_64
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+static_assert(sizeof(glm::mat4x3) == 12 * sizeof(float), "mat4x3 is four packed vec3 columns.");
+
+namespace {
+
+//pointers to each scalar input, so kernels don't depend on glm's member order:
+struct Fields {
+	float const *px, *py, *pz;
+	float const *qx, *qy, *qz, *qw;
+	float const *sx, *sy, *sz;
+	uint32_t const *parent;
+	float *world;
+	size_t stride;
+
+	explicit Fields(TransformArray const &array) :
+		px(&array.position->x), py(&array.position->y), pz(&array.position->z),
+		qx(&array.rotation->x), qy(&array.rotation->y), qz(&array.rotation->z), qw(&array.rotation->w),
+		sx(&array.scale->x), sy(&array.scale->y), sz(&array.scale->z),
+		parent(array.parent), world(&(*array.local_to_world)[0][0]), stride(array.stride) { }
+
+	template< typename T >
+	T &at(T *base, uint32_t i) const {
+		return *reinterpret_cast< T * >(reinterpret_cast< char * >(base) + size_t(i) * stride);
+	}
+	template< typename T >
+	T const &at(T const *base, uint32_t i) const {
+		return *reinterpret_cast< T const * >(reinterpret_cast< char const * >(base) + size_t(i) * stride);
+	}
+};
+
+//local-to-parent matrices for up to this many transforms at once, element-major
+// (local[k][lane] is element k -- column k/3, row k%3 -- of transform 'lane'):
+constexpr uint32_t MaxWidth = 8;
+struct alignas(32) LocalBlock {
+	float local[12][MaxWidth];
+};
+
+//write world = parent * local (both affine, column-major, 12 floats) for one lane of a block:
+void compose_scalar(float const *parent, LocalBlock const &block, uint32_t lane, float *world) {
+	for (uint32_t c = 0; c < 4; ++c) {
+		float l0 = block.local[3*c+0][lane];
+		float l1 = block.local[3*c+1][lane];
+		float l2 = block.local[3*c+2][lane];
+		for (uint32_t r = 0; r < 3; ++r) {
+			world[3*c+r] = parent[0+r] * l0 + parent[3+r] * l1 + parent[6+r] * l2 + (c == 3 ? parent[9+r] : 0.0f);
+		}
+	}
+}
+
+//compose (or copy, for roots) every lane of a block into the output:
+void finish_block_scalar(Fields const &fields, uint32_t const *indices, uint32_t lanes, LocalBlock const &block) {
+	//lanes go in index order, so parents computed earlier in this block are already written:
+	for (uint32_t lane = 0; lane < lanes; ++lane) {
+		uint32_t i = indices[lane];
+		uint32_t parent = fields.at(fields.parent, i);
+		float *world = &fields.at(fields.world, i);
+		if (parent == -1U) {
+			for (uint32_t k = 0; k < 12; ++k) {
+				world[k] = block.local[k][lane];
+			}
+		} else {
+			assert(parent < i);
+			compose_scalar(&fields.at(fields.world, parent), block, lane, world);
+		}
+	}
+}
+
+//--- scalar ---
+
+void compute_scalar(Fields const &fields, uint32_t const *indices, uint32_t count) {
+	LocalBlock block;
+	for (uint32_t b = 0; b < count; ++b) {
+		uint32_t i = indices[b];
+		float x = fields.at(fields.qx, i), y = fields.at(fields.qy, i), z = fields.at(fields.qz, i), w = fields.at(fields.qw, i);
+		float sx = fields.at(fields.sx, i), sy = fields.at(fields.sy, i), sz = fields.at(fields.sz, i);
+
+		//same as glm::mat3_cast, with columns scaled:
+		float x2 = x + x, y2 = y + y, z2 = z + z;
+		float xx = x * x2, yy = y * y2, zz = z * z2;
+		float xy = x * y2, xz = x * z2, yz = y * z2;
+		float wx = w * x2, wy = w * y2, wz = w * z2;
+
+		float (&l)[12][MaxWidth] = block.local;
+		l[0][0] = (1.0f - (yy + zz)) * sx; l[1][0] = (xy + wz) * sx; l[2][0] = (xz - wy) * sx;
+		l[3][0] = (xy - wz) * sy; l[4][0] = (1.0f - (xx + zz)) * sy; l[5][0] = (yz + wx) * sy;
+		l[6][0] = (xz + wy) * sz; l[7][0] = (yz - wx) * sz; l[8][0] = (1.0f - (xx + yy)) * sz;
+		l[9][0] = fields.at(fields.px, i); l[10][0] = fields.at(fields.py, i); l[11][0] = fields.at(fields.pz, i);
+
+		finish_block_scalar(fields, indices + b, 1, block);
+	}
+}
+
+#ifdef WORLD_MATRICES_X86_64
+
+//--- SSE2 (always available on x86-64) ---
+
+//world = parent * local using 4-wide columns:
+// (column loads read into the next column, and stores are ordered so each one fixes up the previous one's spill)
+inline void compose_sse2(float const *parent, LocalBlock const &block, uint32_t lane, float *world) {
+	__m128 p0 = _mm_loadu_ps(parent + 0);
+	__m128 p1 = _mm_loadu_ps(parent + 3);
+	__m128 p2 = _mm_loadu_ps(parent + 6);
+	__m128 p3 = _mm_loadu_ps(parent + 8);
+	p3 = _mm_shuffle_ps(p3, p3, _MM_SHUFFLE(3, 3, 2, 1)); //(p[9], p[10], p[11], -)
+
+	__m128 col[4];
+	for (uint32_t c = 0; c < 4; ++c) {
+		col[c] = _mm_add_ps(
+			_mm_add_ps(
+				_mm_mul_ps(p0, _mm_set1_ps(block.local[3*c+0][lane])),
+				_mm_mul_ps(p1, _mm_set1_ps(block.local[3*c+1][lane]))
+			),
+			_mm_mul_ps(p2, _mm_set1_ps(block.local[3*c+2][lane]))
+		);
+	}
+	col[3] = _mm_add_ps(col[3], p3);
+
+	_mm_storeu_ps(world + 0, col[0]);
+	_mm_storeu_ps(world + 3, col[1]);
+	_mm_storeu_ps(world + 6, col[2]);
+	//last column is only three floats (a 4-wide store would run past the matrix):
+	_mm_storel_pi(reinterpret_cast< __m64 * >(world + 9), col[3]);
+	_mm_store_ss(world + 11, _mm_movehl_ps(col[3], col[3]));
+}
+
+//like finish_block_scalar, but four lanes at a time, with roots stored straight from transposed rows:
+inline void finish_block_sse2(Fields const &fields, uint32_t const *indices, uint32_t lanes, LocalBlock const &block) {
+	for (uint32_t base = 0; base < lanes; base += 4) {
+		__m128 r[12];
+		for (uint32_t k = 0; k < 12; ++k) {
+			r[k] = _mm_load_ps(&block.local[k][base]);
+		}
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+		_MM_TRANSPOSE4_PS(r[4], r[5], r[6], r[7]);
+		_MM_TRANSPOSE4_PS(r[8], r[9], r[10], r[11]);
+		//now r[j], r[4+j], r[8+j] are the twelve floats of lane base+j's matrix:
+		for (uint32_t j = 0; j < 4 && base + j < lanes; ++j) {
+			uint32_t i = indices[base + j];
+			uint32_t parent = fields.at(fields.parent, i);
+			float *world = &fields.at(fields.world, i);
+			if (parent == -1U) {
+				_mm_storeu_ps(world + 0, r[j]);
+				_mm_storeu_ps(world + 4, r[4+j]);
+				_mm_storeu_ps(world + 8, r[8+j]);
+			} else {
+				assert(parent < i);
+				compose_sse2(&fields.at(fields.world, parent), block, base + j, world);
+			}
+		}
+	}
+}
+
+inline __m128 gather_sse2(Fields const &fields, float const *base, uint32_t const *lane_index) {
+	return _mm_set_ps(
+		fields.at(base, lane_index[3]), fields.at(base, lane_index[2]),
+		fields.at(base, lane_index[1]), fields.at(base, lane_index[0])
+	);
+}
+
+void compute_sse2(Fields const &fields, uint32_t const *indices, uint32_t count) {
+	constexpr uint32_t Width = 4;
+	LocalBlock block;
+	for (uint32_t b = 0; b < count; b += Width) {
+		uint32_t lanes = std::min(Width, count - b);
+		//pad a partial block by repeating its last index:
+		uint32_t lane_index[Width];
+		for (uint32_t lane = 0; lane < Width; ++lane) {
+			lane_index[lane] = indices[b + std::min(lane, lanes - 1)];
+		}
+
+		__m128 x = gather_sse2(fields, fields.qx, lane_index);
+		__m128 y = gather_sse2(fields, fields.qy, lane_index);
+		__m128 z = gather_sse2(fields, fields.qz, lane_index);
+		__m128 w = gather_sse2(fields, fields.qw, lane_index);
+		__m128 sx = gather_sse2(fields, fields.sx, lane_index);
+		__m128 sy = gather_sse2(fields, fields.sy, lane_index);
+		__m128 sz = gather_sse2(fields, fields.sz, lane_index);
+
+		__m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+		__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+		__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+		__m128 one = _mm_set1_ps(1.0f);
+
+		float (&l)[12][MaxWidth] = block.local;
+		_mm_store_ps(l[0], _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx));
+		_mm_store_ps(l[1], _mm_mul_ps(_mm_add_ps(xy, wz), sx));
+		_mm_store_ps(l[2], _mm_mul_ps(_mm_sub_ps(xz, wy), sx));
+		_mm_store_ps(l[3], _mm_mul_ps(_mm_sub_ps(xy, wz), sy));
+		_mm_store_ps(l[4], _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy));
+		_mm_store_ps(l[5], _mm_mul_ps(_mm_add_ps(yz, wx), sy));
+		_mm_store_ps(l[6], _mm_mul_ps(_mm_add_ps(xz, wy), sz));
+		_mm_store_ps(l[7], _mm_mul_ps(_mm_sub_ps(yz, wx), sz));
+		_mm_store_ps(l[8], _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz));
+		_mm_store_ps(l[9], gather_sse2(fields, fields.px, lane_index));
+		_mm_store_ps(l[10], gather_sse2(fields, fields.py, lane_index));
+		_mm_store_ps(l[11], gather_sse2(fields, fields.pz, lane_index));
+
+		finish_block_sse2(fields, indices + b, lanes, block);
+	}
+}
+
+//--- AVX2 + FMA ---
+
+TARGET_AVX2 void compute_avx2(Fields const &fields, uint32_t const *indices, uint32_t count) {
+	constexpr uint32_t Width = 8;
+	LocalBlock block;
+	__m256i stride = _mm256_set1_epi32(int(fields.stride));
+	for (uint32_t b = 0; b < count; b += Width) {
+		uint32_t lanes = std::min(Width, count - b);
+		alignas(32) uint32_t lane_index[Width];
+		for (uint32_t lane = 0; lane < Width; ++lane) {
+			lane_index[lane] = indices[b + std::min(lane, lanes - 1)];
+		}
+		//byte offsets of each lane's transform (caller checked these fit in an int):
+		__m256i offset = _mm256_mullo_epi32(_mm256_load_si256(reinterpret_cast< __m256i const * >(lane_index)), stride);
+
+		__m256 x = _mm256_i32gather_ps(fields.qx, offset, 1);
+		__m256 y = _mm256_i32gather_ps(fields.qy, offset, 1);
+		__m256 z = _mm256_i32gather_ps(fields.qz, offset, 1);
+		__m256 w = _mm256_i32gather_ps(fields.qw, offset, 1);
+		__m256 sx = _mm256_i32gather_ps(fields.sx, offset, 1);
+		__m256 sy = _mm256_i32gather_ps(fields.sy, offset, 1);
+		__m256 sz = _mm256_i32gather_ps(fields.sz, offset, 1);
+
+		__m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+		__m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+		__m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+		__m256 one = _mm256_set1_ps(1.0f);
+
+		float (&l)[12][MaxWidth] = block.local;
+		_mm256_store_ps(l[0], _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx));
+		_mm256_store_ps(l[1], _mm256_mul_ps(_mm256_fmadd_ps(x, y2, wz), sx));
+		_mm256_store_ps(l[2], _mm256_mul_ps(_mm256_fmsub_ps(x, z2, wy), sx));
+		_mm256_store_ps(l[3], _mm256_mul_ps(_mm256_fmsub_ps(x, y2, wz), sy));
+		_mm256_store_ps(l[4], _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy));
+		_mm256_store_ps(l[5], _mm256_mul_ps(_mm256_fmadd_ps(y, z2, wx), sy));
+		_mm256_store_ps(l[6], _mm256_mul_ps(_mm256_fmadd_ps(x, z2, wy), sz));
+		_mm256_store_ps(l[7], _mm256_mul_ps(_mm256_fmsub_ps(y, z2, wx), sz));
+		_mm256_store_ps(l[8], _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz));
+		_mm256_store_ps(l[9], _mm256_i32gather_ps(fields.px, offset, 1));
+		_mm256_store_ps(l[10], _mm256_i32gather_ps(fields.py, offset, 1));
+		_mm256_store_ps(l[11], _mm256_i32gather_ps(fields.pz, offset, 1));
+
+		finish_block_sse2(fields, indices + b, lanes, block);
+	}
+}
+
+bool cpu_has_avx2_fma() {
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	bool fma = (info[2] & (1 << 12)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	//the OS also has to save ymm registers on context switches:
+	if (!(fma && osxsave && avx) || (_xgetbv(0) & 6) != 6) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+#endif //WORLD_MATRICES_X86_64
+
+} //namespace
+
+char const *world_matrix_kernel_name(WorldMatrixKernel kernel) {
+	switch (kernel) {
+		case WorldMatrixKernel::Scalar: return "scalar";
+		case WorldMatrixKernel::SSE2: return "sse2";
+		case WorldMatrixKernel::AVX2: return "avx2";
+	}
+	return "unknown";
+}
+
+bool world_matrix_kernel_supported(WorldMatrixKernel kernel) {
+#ifdef WORLD_MATRICES_X86_64
+	static bool const avx2 = cpu_has_avx2_fma();
+	if (kernel == WorldMatrixKernel::AVX2) return avx2;
+	return true;
+#else
+	return kernel == WorldMatrixKernel::Scalar;
+#endif
+}
+
+WorldMatrixKernel best_world_matrix_kernel() {
+	static WorldMatrixKernel const best = []() {
+		if (world_matrix_kernel_supported(WorldMatrixKernel::AVX2)) return WorldMatrixKernel::AVX2;
+		if (world_matrix_kernel_supported(WorldMatrixKernel::SSE2)) return WorldMatrixKernel::SSE2;
+		return WorldMatrixKernel::Scalar;
+	}();
+	return best;
+}
+
+void compute_world_matrices(TransformArray const &array, uint32_t const *indices, uint32_t count, WorldMatrixKernel kernel) {
+	if (count == 0) return;
+	if (!world_matrix_kernel_supported(kernel)) {
+		throw std::runtime_error("World matrix kernel '" + std::string(world_matrix_kernel_name(kernel)) + "' is not supported on this machine.");
+	}
+	assert(array.stride % 4 == 0);
+	Fields fields(array);
+
+#ifdef WORLD_MATRICES_X86_64
+	if (kernel == WorldMatrixKernel::AVX2) {
+		//gathers take 32-bit byte offsets:
+		if (uint64_t(indices[count - 1]) * array.stride <= uint64_t(INT_MAX)) {
+			compute_avx2(fields, indices, count);
+			return;
+		}
+		kernel = WorldMatrixKernel::SSE2;
+	}
+	if (kernel == WorldMatrixKernel::SSE2) {
+		compute_sse2(fields, indices, count);
+		return;
+	}
+#endif
+	compute_scalar(fields, indices, count);
+}
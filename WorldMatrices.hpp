@@ -0,0 +1,50 @@
+#pragma once
+
+/*
+ * Batch computation of local-to-world matrices for arrays of transforms
+ *  stored parent-before-child (like Scene::transforms).
+ *
+ * Local-to-parent matrices are built several transforms at a time
+ *  (8 with AVX2+FMA, 4 with SSE2, 1 without either), then composed with
+ *  their parents' world matrices in order. The widest kernel the CPU
+ *  supports is picked at runtime; the others stay available for comparison.
+ *
+ * Fields are read through a byte stride, so the kernel can work directly
+ *  on an array of structs without copying it into separate arrays first.
+ */
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+enum class WorldMatrixKernel : uint8_t {
+	Scalar,
+	SSE2,
+	AVX2,
+};
+
+//name of a kernel ("scalar", "sse2", "avx2"):
+char const *world_matrix_kernel_name(WorldMatrixKernel kernel);
+//is 'kernel' usable on this CPU / build?
+bool world_matrix_kernel_supported(WorldMatrixKernel kernel);
+//widest supported kernel (checked once):
+WorldMatrixKernel best_world_matrix_kernel();
+
+//where to find each transform's fields; transform i's position is at
+// (char const *)position + i * stride, and so on for the others:
+struct TransformArray {
+	glm::vec3 const *position = nullptr;
+	glm::quat const *rotation = nullptr;
+	glm::vec3 const *scale = nullptr;
+	uint32_t const *parent = nullptr; //-1U for roots
+	glm::mat4x3 *local_to_world = nullptr; //output (parents' entries are also read)
+	size_t stride = 0; //bytes; must be a multiple of 4
+};
+
+//compute local_to_world for the transforms listed in indices[0 .. count):
+// indices must be increasing, and each listed transform's parent must come earlier
+// in the list or already have an up-to-date local_to_world.
+void compute_world_matrices(TransformArray const &array, uint32_t const *indices, uint32_t count,
+	WorldMatrixKernel kernel = best_world_matrix_kernel());
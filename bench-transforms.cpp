@@ -0,0 +1,150 @@
+//Times world-matrix computation over a large synthetic transform hierarchy:
+// usage: bench-transforms [--transforms N] [--roots FRACTION] [--iterations N] [--seed N]
+// Compares the per-transform glm path (Transform::make_local_to_parent, multiplied up the parent chain
+// for every transform) with compute_world_matrices using each kernel this machine supports.
+
+#include "Scene.hpp"
+#include "WorldMatrices.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//the pre-batch path: each transform walks its own parent chain:
+static glm::mat4x3 glm_local_to_world(std::vector< Scene::Transform > const &transforms, uint32_t i) {
+	Scene::Transform const &t = transforms[i];
+	if (t.parent == -1U) {
+		return t.make_local_to_parent();
+	} else {
+		return glm_local_to_world(transforms, t.parent) * glm::mat4(t.make_local_to_parent()); //note: glm::mat4(glm::mat4x3) pads with a (0,0,0,1) row
+	}
+}
+
+int main(int argc, char **argv) {
+	uint32_t count = 10000;
+	float root_fraction = 0.25f;
+	uint32_t iterations = 100;
+	uint32_t seed = 0;
+
+	try {
+		for (int argi = 1; argi < argc; ++argi) {
+			std::string arg = argv[argi];
+			if (arg == "--transforms" && argi + 1 < argc) {
+				count = uint32_t(std::stoul(argv[++argi]));
+			} else if (arg == "--roots" && argi + 1 < argc) {
+				root_fraction = std::stof(argv[++argi]);
+			} else if (arg == "--iterations" && argi + 1 < argc) {
+				iterations = uint32_t(std::stoul(argv[++argi]));
+			} else if (arg == "--seed" && argi + 1 < argc) {
+				seed = uint32_t(std::stoul(argv[++argi]));
+			} else {
+				throw std::runtime_error("Unrecognized argument '" + arg + "'.");
+			}
+		}
+		if (count == 0 || iterations == 0) throw std::runtime_error("--transforms and --iterations must be positive.");
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << "\nUsage:\n\t" << argv[0] << " [--transforms N] [--roots FRACTION] [--iterations N] [--seed N]" << std::endl;
+		return 1;
+	}
+
+	//random hierarchy, parents before children (parents are picked among recent transforms, to keep chains short-ish):
+	std::vector< Scene::Transform > transforms(count);
+	{
+		std::mt19937 mt(seed);
+		std::uniform_real_distribution< float > unit(-1.0f, 1.0f);
+		std::uniform_real_distribution< float > chance(0.0f, 1.0f);
+		for (uint32_t i = 0; i < count; ++i) {
+			Scene::Transform &t = transforms[i];
+			t.position = 10.0f * glm::vec3(unit(mt), unit(mt), unit(mt));
+			t.rotation = glm::normalize(glm::quat(unit(mt), unit(mt), unit(mt), unit(mt)));
+			t.scale = glm::vec3(1.0f) + 0.1f * glm::vec3(unit(mt), unit(mt), unit(mt));
+			if (i > 0 && chance(mt) >= root_fraction) {
+				t.parent = i - 1 - uint32_t(mt() % std::min(i, 16U));
+			}
+		}
+	}
+	std::vector< uint32_t > indices(count);
+	for (uint32_t i = 0; i < count; ++i) indices[i] = i;
+
+	TransformArray array;
+	array.position = &transforms[0].position;
+	array.rotation = &transforms[0].rotation;
+	array.scale = &transforms[0].scale;
+	array.parent = &transforms[0].parent;
+	array.local_to_world = &transforms[0].world_cache.local_to_world;
+	array.stride = sizeof(Scene::Transform);
+
+	//reference results and timing for the glm path:
+	std::vector< glm::mat4x3 > reference(count);
+	auto time = [&](auto &&run) {
+		run(); //(warm up)
+		auto before = std::chrono::high_resolution_clock::now();
+		for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+			run();
+		}
+		auto after = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration< double >(after - before).count() / (double(iterations) * double(count)) * 1e9;
+	};
+
+	std::cout << count << " transforms, " << iterations << " iterations; ns per transform:" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	double glm_ns = time([&]() {
+		for (uint32_t i = 0; i < count; ++i) {
+			reference[i] = glm_local_to_world(transforms, i);
+		}
+	});
+	std::cout << "  " << std::setw(24) << std::left << "glm, per transform" << std::right << std::setw(10) << glm_ns << std::endl;
+
+	double glm_linear_ns = time([&]() {
+		for (uint32_t i = 0; i < count; ++i) {
+			Scene::Transform const &t = transforms[i];
+			if (t.parent == -1U) {
+				reference[i] = t.make_local_to_parent();
+			} else {
+				reference[i] = reference[t.parent] * glm::mat4(t.make_local_to_parent());
+			}
+		}
+	});
+	std::cout << "  " << std::setw(24) << std::left << "glm, parents first" << std::right << std::setw(10) << glm_linear_ns
+	          << std::setw(9) << glm_ns / glm_linear_ns << "x" << std::endl;
+
+	for (WorldMatrixKernel kernel : { WorldMatrixKernel::Scalar, WorldMatrixKernel::SSE2, WorldMatrixKernel::AVX2 }) {
+		std::string label = std::string("batch, ") + world_matrix_kernel_name(kernel);
+		if (!world_matrix_kernel_supported(kernel)) {
+			std::cout << "  " << std::setw(24) << std::left << label << std::right << "  (not supported here)" << std::endl;
+			continue;
+		}
+		double ns = time([&]() {
+			compute_world_matrices(array, indices.data(), count, kernel);
+		});
+
+		//agreement with glm (relative to each matrix's largest entry):
+		float worst = 0.0f;
+		for (uint32_t i = 0; i < count; ++i) {
+			glm::mat4x3 const &a = transforms[i].world_cache.local_to_world;
+			glm::mat4x3 const &b = reference[i];
+			float size = 1.0f;
+			float error = 0.0f;
+			for (uint32_t c = 0; c < 4; ++c) {
+				for (uint32_t r = 0; r < 3; ++r) {
+					size = std::max(size, std::abs(b[c][r]));
+					error = std::max(error, std::abs(a[c][r] - b[c][r]));
+				}
+			}
+			worst = std::max(worst, error / size);
+		}
+
+		std::cout << "  " << std::setw(24) << std::left << label << std::right << std::setw(10) << ns
+		          << std::setw(9) << glm_ns / ns << "x" << "   (max relative difference " << std::scientific << std::setprecision(1) << worst << std::fixed << std::setprecision(2) << ")"
+		          << (kernel == best_world_matrix_kernel() ? "  <- used by Scene" : "") << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,179 @@
+//Runs the dispatch simulation without a window (no SDL video / OpenGL):
+// usage: headless [--shifts N] [--shift-length SECONDS] [--mesh NAME] [--seed N] [--step SECONDS] [--couriers N] [--threads N] [--dispatch greedy|hungarian|insertion] [--orders-per-hour R] [--rate-curve M,M,...] [--patience SECONDS] [--record TRACE] [--replay TRACE] [--events FILE] [--checkpoint SECONDS FILE] [--restore FILE]
+
+#include "EventRecorder.hpp"
+#include "LocationCatalog.hpp"
+#include "Simulation.hpp"
+#include "SimClock.hpp"
+#include "TravelTimes.hpp"
+#include "WalkMesh.hpp"
+#include "data_path.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, char **argv) {
+	uint32_t shifts = 100;
+	float shift_length = 2.0f * 60.0f * 60.0f; //two hours
+	std::string mesh_name = "ZMesh";
+	uint32_t seed = 0;
+	uint32_t couriers = 1;
+	uint32_t threads = 1;
+	std::string dispatch = "greedy";
+	DemandModel demand;
+	std::string record_path, replay_path;
+	std::string events_path;
+	float checkpoint_time = 0.0f;
+	std::string checkpoint_path, restore_path;
+	SimClock clock;
+
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--shifts" && argi + 1 < argc) {
+			shifts = uint32_t(std::stoul(argv[++argi]));
+		} else if (arg == "--shift-length" && argi + 1 < argc) {
+			shift_length = std::stof(argv[++argi]);
+		} else if (arg == "--mesh" && argi + 1 < argc) {
+			mesh_name = argv[++argi];
+		} else if (arg == "--seed" && argi + 1 < argc) {
+			seed = uint32_t(std::stoul(argv[++argi]));
+		} else if (arg == "--step" && argi + 1 < argc) {
+			clock.step = std::stof(argv[++argi]);
+		} else if (arg == "--couriers" && argi + 1 < argc) {
+			couriers = uint32_t(std::stoul(argv[++argi]));
+		} else if (arg == "--threads" && argi + 1 < argc) {
+			threads = uint32_t(std::stoul(argv[++argi]));
+		} else if (arg == "--dispatch" && argi + 1 < argc) {
+			dispatch = argv[++argi];
+		} else if (arg == "--orders-per-hour" && argi + 1 < argc) {
+			demand.orders_per_hour = std::stof(argv[++argi]);
+		} else if (arg == "--rate-curve" && argi + 1 < argc) {
+			//multipliers spread evenly over the shift, e.g. "0.5,2,1,2,0.5" for two rushes:
+			std::string list = argv[++argi];
+			demand.rate_curve.clear();
+			for (size_t begin = 0; begin <= list.size();) {
+				size_t end = std::min(list.find(',', begin), list.size());
+				demand.rate_curve.emplace_back(std::stof(list.substr(begin, end - begin)));
+				begin = end + 1;
+			}
+		} else if (arg == "--patience" && argi + 1 < argc) {
+			demand.patience = std::stof(argv[++argi]);
+		} else if (arg == "--record" && argi + 1 < argc) {
+			record_path = argv[++argi];
+		} else if (arg == "--replay" && argi + 1 < argc) {
+			replay_path = argv[++argi];
+		} else if (arg == "--events" && argi + 1 < argc) {
+			events_path = argv[++argi];
+		} else if (arg == "--checkpoint" && argi + 2 < argc) {
+			checkpoint_time = std::stof(argv[++argi]);
+			checkpoint_path = argv[++argi];
+		} else if (arg == "--restore" && argi + 1 < argc) {
+			restore_path = argv[++argi];
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--shifts N] [--shift-length SECONDS] [--mesh NAME] [--seed N] [--step SECONDS] [--couriers N] [--threads N] [--dispatch greedy|hungarian|insertion] [--orders-per-hour R] [--rate-curve M,M,...] [--patience SECONDS] [--record TRACE] [--replay TRACE] [--events FILE] [--checkpoint SECONDS FILE] [--restore FILE]" << std::endl;
+			return 1;
+		}
+	}
+
+	//(a snapshot is one shift in progress)
+	if (!restore_path.empty()) shifts = 1;
+
+	try {
+		//stores and clients (from the scene's "loc0" chunk, if it has one):
+		set_location_catalog(LocationCatalog::from_scene_file(data_path("delivery.scene")));
+		std::cout << "Loaded " << get_location_catalog().stores.size() << " stores and "
+		          << get_location_catalog().clients.size() << " clients." << std::endl;
+
+		WalkMeshes walkmeshes(data_path("delivery.w"));
+		WalkMesh const &walkmesh = walkmeshes.lookup(mesh_name);
+
+		//fleet movement is split across threads (results don't depend on the thread count):
+		ThreadPool pool(threads);
+
+		//travel times at fleet speed (cached next to delivery.w after the first run):
+		auto tables_before = std::chrono::high_resolution_clock::now();
+		TravelTimes travel_times = TravelTimes::load_or_build(
+			TravelTimes::cache_path(data_path("delivery.w"), mesh_name), walkmesh, Fleet(walkmesh).max_speed, 2.0f, &pool
+		);
+		auto tables_after = std::chrono::high_resolution_clock::now();
+		std::cout << "Travel times for " << travel_times.count << " points ready in "
+		          << std::chrono::duration< float >(tables_after - tables_before).count() << "s." << std::endl;
+
+		demand.period = shift_length;
+
+		//(like --record, only the first shift's events are recorded)
+		std::unique_ptr< EventRecorder > recorder;
+		if (!events_path.empty()) recorder = std::make_unique< EventRecorder >(events_path);
+
+		uint64_t delivered = 0;
+		uint64_t expired = 0;
+		uint64_t cancelled = 0;
+		int64_t income = 0;
+
+		auto before = std::chrono::high_resolution_clock::now();
+		for (uint32_t shift = 0; shift < shifts; ++shift) {
+			//each shift gets its own seed, so runs are reproducible shift-by-shift:
+			Simulation simulation(walkmesh, travel_times, glm::vec3(0.0f), seed + shift, couriers);
+			simulation.order_controller.set_demand(demand);
+			//every shift replays the whole trace; only the first shift is recorded:
+			if (!replay_path.empty()) simulation.order_controller.replay(replay_path);
+			if (!record_path.empty() && shift == 0) simulation.order_controller.record(record_path);
+			if (shift == 0) simulation.set_recorder(recorder.get());
+			simulation.dispatcher = Dispatcher::make(dispatch);
+			simulation.pool = &pool;
+			//continue from a snapshot (e.g. with a different dispatcher):
+			uint64_t first_step = 0;
+			if (!restore_path.empty()) {
+				std::ifstream file(restore_path, std::ios::binary);
+				if (!file) throw std::runtime_error("Failed to open snapshot '" + restore_path + "'.");
+				simulation.load(file);
+				first_step = uint64_t(std::llround(simulation.time / double(clock.step)));
+			}
+			//(like --record, only the first shift is checkpointed)
+			bool checkpoint = (!checkpoint_path.empty() && shift == 0);
+
+			//no real time involved: just run fixed steps until the shift is over:
+			uint64_t steps = uint64_t(std::ceil(double(shift_length) / double(clock.step)));
+			for (uint64_t step = first_step; step < steps; ++step) {
+				if (checkpoint && simulation.time >= checkpoint_time) {
+					std::ofstream file(checkpoint_path, std::ios::binary);
+					simulation.save(&file);
+					if (!file) throw std::runtime_error("Failed to write snapshot '" + checkpoint_path + "'.");
+					std::cout << "Saved snapshot at " << simulation.time << "s to '" << checkpoint_path << "'." << std::endl;
+					checkpoint = false;
+				}
+				simulation.update(clock.step);
+			}
+			delivered += simulation.order_controller.delivered_orders;
+			expired += simulation.order_controller.expired_orders;
+			cancelled += simulation.order_controller.cancelled_orders;
+			income += simulation.order_controller.get_income();
+		}
+		auto after = std::chrono::high_resolution_clock::now();
+		float seconds = std::chrono::duration< float >(after - before).count();
+
+		std::cout << "Ran " << shifts << " shifts of " << shift_length << "s with " << couriers << " courier(s) in " << seconds << "s"
+		          << " (" << (seconds > 0.0f ? shifts / seconds * 60.0f : 0.0f) << " shifts/minute)." << std::endl;
+		float hours = float(shifts) * shift_length / 3600.0f;
+		std::cout << "  dispatch: " << dispatch << "\n"
+		          << "  delivered: " << delivered << " (" << (hours > 0.0f ? delivered / hours : 0.0f) << " orders/hour)\n"
+		          << "  expired: " << expired << " (" << (delivered + expired > 0 ? 100.0f * delivered / float(delivered + expired) : 0.0f) << "% on time)\n"
+		          << "  cancelled: " << cancelled << " (never accepted)\n"
+		          << "  income: $" << income << std::endl;
+		if (recorder) {
+			recorder.reset(); //(flushes)
+			std::cout << "Recorded events to '" << events_path << "'." << std::endl;
+		}
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
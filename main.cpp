@@ -10,6 +10,12 @@
 //For asset loading:
 #include "Load.hpp"
 
+//Fixed-step simulation clock:
+#include "SimClock.hpp"
+
+//for recording events:
+#include "EventRecorder.hpp"
+
 //For sound init:
 #include "Sound.hpp"
 
@@ -28,6 +34,7 @@
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <string>
 
 int main(int argc, char **argv) {
 #ifdef _WIN32
@@ -35,6 +42,32 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
+	//------------  command line ------------
+
+	//simulation speed is controlled by the clock, not the frame rate:
+	SimClock clock;
+	bool seeded = false;
+	uint32_t seed = 0;
+	std::string events_path;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--time-scale" && argi + 1 < argc) {
+			clock.time_scale = std::stof(argv[++argi]);
+		} else if (arg == "--step" && argi + 1 < argc) {
+			clock.step = std::stof(argv[++argi]);
+		} else if (arg == "--uncapped") {
+			clock.uncapped = true;
+		} else if (arg == "--seed" && argi + 1 < argc) {
+			seeded = true;
+			seed = uint32_t(std::stoul(argv[++argi]));
+		} else if (arg == "--events" && argi + 1 < argc) {
+			events_path = argv[++argi];
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--time-scale X] [--step SECONDS] [--uncapped] [--seed N] [--events FILE]" << std::endl;
+			return 1;
+		}
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -85,7 +118,10 @@ int main(int argc, char **argv) {
 	init_GL();
 
 	//Set VSYNC + Late Swap (prevents crazy FPS):
-	if (SDL_GL_SetSwapInterval(-1) != 0) {
+	if (clock.uncapped) {
+		//...unless running as fast as possible:
+		SDL_GL_SetSwapInterval(0);
+	} else if (SDL_GL_SetSwapInterval(-1) != 0) {
 		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
 		if (SDL_GL_SetSwapInterval(1) != 0) {
 			std::cerr << "NOTE: couldn't set vsync (" << SDL_GetError() << ")." << std::endl;
@@ -120,7 +156,15 @@ int main(int argc, char **argv) {
 	on_resize();
 
 	//------------ create game mode + make current --------------
-	Mode::set_current(std::make_shared< PlayMode >());
+	//(optional) record order and player events; outlives the game loop:
+	std::unique_ptr< EventRecorder > recorder;
+	if (!events_path.empty()) recorder = std::make_unique< EventRecorder >(events_path);
+	{
+		auto play_mode = std::make_shared< PlayMode >();
+		if (seeded) play_mode->order_controller->seed(seed);
+		play_mode->order_controller->recorder = recorder.get();
+		Mode::set_current(play_mode);
+	}
 
 	//This will loop until the current mode is set to null:
 	while (Mode::current) {
@@ -159,7 +203,7 @@ int main(int argc, char **argv) {
 			if (!Mode::current) break;
 		}
 
-		{ //(2) call the current mode's "update" function to deal with elapsed time:
+		{ //(2) call the current mode's "update" function once per fixed step of simulated time:
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
@@ -169,7 +213,10 @@ int main(int argc, char **argv) {
 			//lag to avoid spiral of death:
 			elapsed = std::min(0.1f, elapsed);
 
-			Mode::current->update(elapsed);
+			for (uint32_t steps = clock.advance(elapsed); steps > 0; --steps) {
+				Mode::current->update(clock.step);
+				if (!Mode::current) break;
+			}
 			if (!Mode::current) break;
 		}
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <string>
 #include <vector>
 #include <stdexcept>
 #include <cassert>
@@ -35,7 +36,7 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 	}
 
 	to.resize(header.size / sizeof(T));
-	if (!from.read(reinterpret_cast< char * >(&to[0]), to.size() * sizeof(T))) {
+	if (!from.read(reinterpret_cast< char * >(to.data()), to.size() * sizeof(T))) {
 		throw std::runtime_error("Failed to read chunk data.");
 	}
 }
@@ -63,3 +64,55 @@ void write_chunk(std::string const &magic, std::vector< T > const &from, std::os
 	to.write(reinterpret_cast< const char * >(&header), sizeof(header));
 	to.write(reinterpret_cast< const char * >(from.data()), from.size() * sizeof(T));
 }
+
+//helpers for state snapshots -- a single structure as a one-element chunk:
+template< typename T >
+void write_chunk_value(std::string const &magic, T const &value, std::ostream *to) {
+	write_chunk(magic, std::vector< T >(1, value), to);
+}
+
+template< typename T >
+T read_chunk_value(std::istream &from, std::string const &magic) {
+	std::vector< T > values;
+	read_chunk(from, magic, &values);
+	if (values.size() != 1) {
+		throw std::runtime_error("Expected exactly one element in '" + magic + "' chunk");
+	}
+	return values[0];
+}
+
+//..and a list of lists, as a chunk of lengths ('magic') followed by a chunk of all elements ('items_magic'):
+template< typename T >
+void write_nested_chunks(std::string const &magic, std::string const &items_magic, std::vector< std::vector< T > > const &from, std::ostream *to) {
+	std::vector< uint32_t > lengths;
+	std::vector< T > items;
+	lengths.reserve(from.size());
+	for (auto const &list : from) {
+		lengths.emplace_back(uint32_t(list.size()));
+		items.insert(items.end(), list.begin(), list.end());
+	}
+	write_chunk(magic, lengths, to);
+	write_chunk(items_magic, items, to);
+}
+
+template< typename T >
+void read_nested_chunks(std::istream &from, std::string const &magic, std::string const &items_magic, std::vector< std::vector< T > > *to_) {
+	assert(to_);
+	auto &to = *to_;
+	std::vector< uint32_t > lengths;
+	std::vector< T > items;
+	read_chunk(from, magic, &lengths);
+	read_chunk(from, items_magic, &items);
+	to.resize(lengths.size());
+	size_t begin = 0;
+	for (size_t i = 0; i < lengths.size(); ++i) {
+		if (lengths[i] > items.size() - begin) {
+			throw std::runtime_error("Lengths in '" + magic + "' chunk overrun '" + items_magic + "' chunk");
+		}
+		to[i].assign(items.begin() + begin, items.begin() + begin + lengths[i]);
+		begin += lengths[i];
+	}
+	if (begin != items.size()) {
+		throw std::runtime_error("Lengths in '" + magic + "' chunk don't cover '" + items_magic + "' chunk");
+	}
+}
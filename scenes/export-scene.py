@@ -57,12 +57,15 @@ else:
 # msh0 len < uint uint uint > [hierarchy point + mesh name]
 # cam0 len < uint params > [heirarchy point + camera params]
 # lig0 len < uint params > [hierarchy point + light params]
+# loc0 len < uint uint vec3 u8vec4 uint > [location name + position + color + kind] (optional)
+#   objects with a custom "location" property of "store" or "client" become locations
 
 strings_data = b""
 xfh_data = b""
 mesh_data = b""
 camera_data = b""
 lamp_data = b""
+location_data = b""
 
 #write_string will add a string to the strings section and return a packed (begin,end) reference:
 def write_string(string):
@@ -188,6 +191,22 @@ def write_light(obj):
 		lamp_data += struct.pack('f', 0.0)
 	
 
+def write_location(obj):
+	global location_data
+	kind = obj["location"]
+	if kind not in ("store", "client"):
+		print("ERROR: object '" + obj.name + "' has location '" + str(kind) + "' (expecting 'store' or 'client').")
+		exit(1)
+	print("location: " + parent_names() + obj.name + " (" + kind + ")")
+	world = obj.matrix_world
+	for parent in reversed(instance_parents):
+		world = parent.matrix_world @ world
+	position = world.translation
+	location_data += write_string(obj.name)
+	location_data += struct.pack('fff', position.x, position.y, position.z)
+	location_data += struct.pack('BBBB', *[int(max(0.0, min(1.0, c)) * 255) for c in obj.color])
+	location_data += struct.pack('I', 0 if kind == "store" else 1)
+
 written = set()
 def write_objects(from_collection):
 	global instance_parents
@@ -195,6 +214,8 @@ def write_objects(from_collection):
 	for obj in from_collection.objects:
 		if tuple(instance_parents + [obj]) in written: continue
 		written.add(tuple(instance_parents + [obj]))
+		if "location" in obj:
+			write_location(obj)
 		if obj.type == 'MESH':
 			write_mesh(obj)
 		elif obj.type == 'CAMERA':
@@ -225,6 +246,8 @@ write_chunk(b'xfh0', xfh_data)
 write_chunk(b'msh0', mesh_data)
 write_chunk(b'cam0', camera_data)
 write_chunk(b'lmp0', lamp_data)
+if len(location_data) > 0:
+	write_chunk(b'loc0', location_data)
 
 print("Wrote " + str(blob.tell()) + " bytes to '" + outfile + "'")
 blob.close()
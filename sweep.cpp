@@ -0,0 +1,241 @@
+//Runs headless simulations over a grid of parameters and summarizes each configuration:
+// usage: sweep [--max-speed V,V,...] [--acceleration A,A,...] [--order-dis D,D,...] [--orders-per-hour R,R,...]
+//              [--couriers N,N,...] [--dispatch NAME,NAME,...] [--shifts N] [--shift-length SECONDS] [--mesh NAME]
+//              [--seed N] [--step SECONDS] [--threads N] [--out FILE]
+// Every combination of the listed values is run for --shifts shifts (seeds seed .. seed+shifts-1);
+// simulations run in parallel, one per thread, sharing the walkmesh, locations, and travel-time table.
+
+#include "LocationCatalog.hpp"
+#include "Simulation.hpp"
+#include "SimClock.hpp"
+#include "ThreadPool.hpp"
+#include "TravelTimes.hpp"
+#include "WalkMesh.hpp"
+#include "data_path.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+//split "a,b,c":
+static std::vector< std::string > split_list(std::string const &list) {
+	std::vector< std::string > ret;
+	for (size_t begin = 0; begin <= list.size();) {
+		size_t end = std::min(list.find(',', begin), list.size());
+		ret.emplace_back(list.substr(begin, end - begin));
+		begin = end + 1;
+	}
+	return ret;
+}
+
+static std::vector< float > parse_floats(std::string const &list) {
+	std::vector< float > ret;
+	for (auto const &item : split_list(list)) ret.emplace_back(std::stof(item));
+	return ret;
+}
+
+static std::vector< uint32_t > parse_uints(std::string const &list) {
+	std::vector< uint32_t > ret;
+	for (auto const &item : split_list(list)) ret.emplace_back(uint32_t(std::stoul(item)));
+	return ret;
+}
+
+//one point on the grid:
+struct Config {
+	float max_speed;
+	float acceleration;
+	float order_dis;
+	float orders_per_hour;
+	uint32_t couriers;
+	std::string dispatch;
+};
+
+//totals over a configuration's shifts:
+struct Result {
+	uint64_t delivered = 0;
+	uint64_t expired = 0;
+	uint64_t cancelled = 0;
+	int64_t income = 0;
+};
+
+int main(int argc, char **argv) {
+	//defaults match headless (and PlayMode's car):
+	std::vector< float > max_speeds{4.0f};
+	std::vector< float > accelerations{4.0f};
+	std::vector< float > order_diss{2.0f};
+	std::vector< float > orders_per_hours{DemandModel().orders_per_hour};
+	std::vector< uint32_t > courier_counts{3};
+	std::vector< std::string > dispatches{"greedy"};
+	uint32_t shifts = 10;
+	float shift_length = 2.0f * 60.0f * 60.0f; //two hours
+	std::string mesh_name = "ZMesh";
+	uint32_t seed = 0;
+	uint32_t threads = std::max(1U, std::thread::hardware_concurrency());
+	std::string out_path;
+	SimClock clock;
+
+	try {
+		for (int argi = 1; argi < argc; ++argi) {
+			std::string arg = argv[argi];
+			if (arg == "--max-speed" && argi + 1 < argc) {
+				max_speeds = parse_floats(argv[++argi]);
+			} else if (arg == "--acceleration" && argi + 1 < argc) {
+				accelerations = parse_floats(argv[++argi]);
+			} else if (arg == "--order-dis" && argi + 1 < argc) {
+				order_diss = parse_floats(argv[++argi]);
+			} else if (arg == "--orders-per-hour" && argi + 1 < argc) {
+				orders_per_hours = parse_floats(argv[++argi]);
+			} else if (arg == "--couriers" && argi + 1 < argc) {
+				courier_counts = parse_uints(argv[++argi]);
+			} else if (arg == "--dispatch" && argi + 1 < argc) {
+				dispatches = split_list(argv[++argi]);
+			} else if (arg == "--shifts" && argi + 1 < argc) {
+				shifts = uint32_t(std::stoul(argv[++argi]));
+			} else if (arg == "--shift-length" && argi + 1 < argc) {
+				shift_length = std::stof(argv[++argi]);
+			} else if (arg == "--mesh" && argi + 1 < argc) {
+				mesh_name = argv[++argi];
+			} else if (arg == "--seed" && argi + 1 < argc) {
+				seed = uint32_t(std::stoul(argv[++argi]));
+			} else if (arg == "--step" && argi + 1 < argc) {
+				clock.step = std::stof(argv[++argi]);
+			} else if (arg == "--threads" && argi + 1 < argc) {
+				threads = uint32_t(std::stoul(argv[++argi]));
+			} else if (arg == "--out" && argi + 1 < argc) {
+				out_path = argv[++argi];
+			} else {
+				throw std::runtime_error("Unrecognized argument '" + arg + "'.");
+			}
+		}
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << "\nUsage:\n\t" << argv[0] << " [--max-speed V,V,...] [--acceleration A,A,...] [--order-dis D,D,...] [--orders-per-hour R,R,...] [--couriers N,N,...] [--dispatch NAME,NAME,...] [--shifts N] [--shift-length SECONDS] [--mesh NAME] [--seed N] [--step SECONDS] [--threads N] [--out FILE]" << std::endl;
+		return 1;
+	}
+
+	try {
+		//shared, read-only world data:
+		set_location_catalog(LocationCatalog::from_scene_file(data_path("delivery.scene")));
+		WalkMeshes walkmeshes(data_path("delivery.w"));
+		WalkMesh const &walkmesh = walkmeshes.lookup(mesh_name);
+
+		ThreadPool pool(threads);
+
+		//route lengths don't depend on speed, so one table (with a speed-specific copy per max speed) serves every configuration:
+		TravelTimes base_times = TravelTimes::load_or_build(
+			TravelTimes::cache_path(data_path("delivery.w"), mesh_name), walkmesh, max_speeds[0], 2.0f, &pool
+		);
+		std::map< float, std::unique_ptr< TravelTimes > > travel_times;
+		for (float speed : max_speeds) {
+			if (!(speed > 0.0f)) throw std::runtime_error("--max-speed values must be positive.");
+			if (travel_times.count(speed)) continue;
+			auto times = std::make_unique< TravelTimes >(base_times);
+			times->speed = speed;
+			times->inv_speed = 1.0f / speed;
+			travel_times.emplace(speed, std::move(times));
+		}
+		for (auto const &name : dispatches) {
+			Dispatcher::make(name); //(throws on unknown names before any work starts)
+		}
+
+		//the grid:
+		std::vector< Config > configs;
+		for (float max_speed : max_speeds) {
+			for (float acceleration : accelerations) {
+				for (float order_dis : order_diss) {
+					for (float orders_per_hour : orders_per_hours) {
+						for (uint32_t couriers : courier_counts) {
+							for (auto const &dispatch : dispatches) {
+								configs.emplace_back(Config{max_speed, acceleration, order_dis, orders_per_hour, couriers, dispatch});
+							}
+						}
+					}
+				}
+			}
+		}
+
+		std::cout << "Running " << configs.size() << " configuration(s) x " << shifts << " shift(s) on " << pool.size() << " thread(s)..." << std::endl;
+
+		//one job per (configuration, shift); each job writes only its own result slot:
+		uint32_t jobs = uint32_t(configs.size()) * shifts;
+		std::vector< Result > job_results(jobs);
+		uint64_t steps = uint64_t(std::ceil(double(shift_length) / double(clock.step)));
+
+		auto before = std::chrono::high_resolution_clock::now();
+		pool.parallel_for(jobs, 1, [&](uint32_t begin, uint32_t end){
+			for (uint32_t job = begin; job < end; ++job) {
+				Config const &config = configs[job / shifts];
+				uint32_t shift = job % shifts;
+
+				Simulation simulation(walkmesh, *travel_times.at(config.max_speed), glm::vec3(0.0f), seed + shift, config.couriers);
+				DemandModel demand;
+				demand.orders_per_hour = config.orders_per_hour;
+				simulation.order_controller.set_demand(demand);
+				simulation.fleet.max_speed = config.max_speed;
+				simulation.fleet.acceleration = config.acceleration;
+				simulation.order_dis = config.order_dis;
+				simulation.dispatcher = Dispatcher::make(config.dispatch);
+
+				for (uint64_t step = 0; step < steps; ++step) {
+					simulation.update(clock.step);
+				}
+
+				Result &result = job_results[job];
+				result.delivered = simulation.order_controller.delivered_orders;
+				result.expired = simulation.order_controller.expired_orders;
+				result.cancelled = simulation.order_controller.cancelled_orders;
+				result.income = simulation.order_controller.get_income();
+			}
+		});
+		auto after = std::chrono::high_resolution_clock::now();
+
+		//summary table (tab-separated, one row per configuration):
+		std::ostringstream table;
+		table << "max_speed\tacceleration\torder_dis\torders_per_hour\tcouriers\tdispatch"
+		      << "\tdelivered\texpired\tcancelled\ton_time\tdelivered_per_hour\tincome_per_shift\n";
+		float hours = float(shifts) * shift_length / 3600.0f;
+		for (uint32_t c = 0; c < configs.size(); ++c) {
+			Result total;
+			for (uint32_t shift = 0; shift < shifts; ++shift) {
+				Result const &r = job_results[c * shifts + shift];
+				total.delivered += r.delivered;
+				total.expired += r.expired;
+				total.cancelled += r.cancelled;
+				total.income += r.income;
+			}
+			Config const &config = configs[c];
+			uint64_t finished = total.delivered + total.expired;
+			table << std::defaultfloat << std::setprecision(6)
+			      << config.max_speed << '\t' << config.acceleration << '\t' << config.order_dis << '\t'
+			      << config.orders_per_hour << '\t' << config.couriers << '\t' << config.dispatch << '\t'
+			      << total.delivered << '\t' << total.expired << '\t' << total.cancelled << '\t'
+			      << std::fixed << std::setprecision(4) << (finished > 0 ? total.delivered / double(finished) : 0.0) << '\t'
+			      << std::setprecision(1) << (hours > 0.0f ? total.delivered / hours : 0.0f) << '\t'
+			      << (shifts > 0 ? total.income / double(shifts) : 0.0) << '\n';
+		}
+
+		std::cout << table.str();
+		std::cout << "Ran " << jobs << " shift(s) in " << std::chrono::duration< float >(after - before).count() << "s." << std::endl;
+
+		if (!out_path.empty()) {
+			std::ofstream out(out_path);
+			out << table.str();
+			if (!out) throw std::runtime_error("Failed to write summary to '" + out_path + "'.");
+			std::cout << "Wrote summary to '" << out_path << "'." << std::endl;
+		}
+	} catch (std::exception const &e) {
+		std::cerr << "Unhandled exception:\n" << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}